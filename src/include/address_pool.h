@@ -3,19 +3,12 @@
 
 #include "bitmap.h"
 #include "os_type.h"
-const int MAX_PAGES = 200;
+#include "page_lru.h"
 
-class AddressPool
+class AddressPool : public PageLRU
 {
 public:
     BitMap resources;
-    int startAddress;
-    // lru队列
-    int lrucnt[MAX_PAGES];
-    // 用于记录对应页的索引
-    int lruindex[MAX_PAGES];
-    // 局部时钟
-    int clock;
 public:
     AddressPool();
     // 初始化地址池
@@ -24,9 +17,6 @@ public:
     int allocate(const int count);
     // 释放若干页的空间
     void release(const int address, const int amount);
-    // 更新LRU数组
-    void LRU();
-    int Out();
 };
 
-#endif
\ No newline at end of file
+#endif
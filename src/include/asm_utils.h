@@ -12,10 +12,17 @@ extern "C" void asm_in_port(uint16 port, uint8 *value);
 extern "C" void asm_enable_interrupt();
 extern "C" void asm_time_interrupt_handler();
 extern "C" void asm_pageFault_handler();
+extern "C" void asm_disk_interrupt_handler();
 extern "C" int asm_interrupt_status();
 extern "C" void asm_disable_interrupt();
 extern "C" void asm_switch_thread(void *cur, void *next);
 extern "C" void asm_atomic_exchange(uint32 *reg, uint32 *mem);
+extern "C" uint32 asm_atomic_fetch_add(volatile uint32 *mem, uint32 value);
+extern "C" uint32 asm_atomic_cmpxchg(volatile uint32 *mem, uint32 expected, uint32 desired);
+extern "C" void asm_cpu_pause();
+extern "C" void asm_memory_barrier();
+// 开中断并停机直到下一个中断
+extern "C" void asm_idle();
 extern "C" void asm_init_page_reg(int *directory);
 extern "C" int asm_system_call(int index, int first = 0, int second = 0, int third = 0, int forth = 0, int fifth = 0);
 extern "C" int asm_system_call_handler();
@@ -25,5 +32,18 @@ extern "C" void asm_start_process(int stack);
 extern "C" void asm_update_cr3(int address);
 extern "C" void asm_inw_port(int port, void *value);
 extern "C" void asm_outw_port(int port, int value);
+extern "C" void asm_inl_port(uint16 port, uint32 *value);
+extern "C" void asm_outl_port(uint16 port, uint32 value);
 extern "C" void asm_update_tlb();
+extern "C" uint64 asm_read_tsc();
+extern "C" void asm_cpuid(uint32 leaf, uint32 *result);
+extern "C" void asm_enable_global_pages();
+extern "C" void asm_invlpg(int address);
+extern "C" void asm_enable_sse();
+extern "C" void asm_memcpy(void *dst, const void *src, uint32 length);
+extern "C" void asm_memcpy_backward(void *dst, const void *src, uint32 length);
+extern "C" void asm_memset(void *dst, uint32 value, uint32 length);
+extern "C" void asm_copy_page_sse2(void *dst, const void *src);
+extern "C" void asm_clear_page_sse2(void *dst);
+extern "C" uint64 asm_udiv64(uint64 dividend, uint32 divisor);
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "os_type.h"
+#include "sync.h"
+
+class SystemClock
+{
+public:
+    uint32 frequency; // 时钟中断频率，Hz
+    uint64 jiffies;   // 启动以来发生的时钟中断次数
+    uint32 tscKHz;    // 校准得到的TSC频率，kHz
+    // TSC周期数到纳秒的换算系数，ns = (cycles * mult) >> shift
+    uint32 mult;
+    uint32 shift;
+    uint64 tscBase; // 最近一次时钟中断时的TSC
+    uint64 nsBase;  // tscBase对应的纳秒数
+    SeqLock timeLock; // 保护jiffies、tscBase和nsBase
+
+public:
+    SystemClock();
+    // 设置时钟中断频率并校准TSC
+    // frequency 时钟中断频率，超出[MIN_TIMER_FREQUENCY, MAX_TIMER_FREQUENCY]时取边界值
+    void initialize(uint32 frequency);
+    // 时钟中断时调用，推进jiffies并更新时间基准
+    void tick();
+    // 返回启动以来经过的纳秒数
+    uint64 monotonicNs();
+    // 返回启动以来发生的时钟中断次数
+    uint64 getJiffies();
+    // 将微秒数转换为时钟中断次数，向上取整，至少为1
+    uint32 usToTicks(uint32 us);
+    // 将时钟中断次数转换为微秒数
+    uint32 ticksToUs(uint32 ticks);
+
+private:
+    // 使用PIT通道2校准TSC，返回10ms内的TSC周期数
+    uint32 calibrateTSC();
+    // 将TSC周期数转换为纳秒
+    uint64 cyclesToNs(uint64 cycles);
+};
+
+// 返回启动以来经过的纳秒数
+uint64 monotonic_ns();
+
+#endif
@@ -1,147 +1,143 @@
 #ifndef DISK_H
 #define DISK_H
 
-#include "asm_utils.h"
 #include "os_type.h"
-#include "stdio.h"
+#include "os_constant.h"
+#include "intrusive_list.h"
+#include "wait_queue.h"
 
 #define SECTOR_SIZE 512
 
+// 单个请求最多传输的扇区数，更长的传输拆分成多个请求
+const int DISK_MAX_SECTORS = 128;
+// 单个请求的缓冲区最多跨越的物理页数
+const int DISK_MAX_SEGMENTS = DISK_MAX_SECTORS * SECTOR_SIZE / PAGE_SIZE + 1;
+// 请求从提交到完成的最长时间，微秒
+const int DISK_TIMEOUT_US = 5000000;
+
+// 请求的状态
+enum DiskRequestStatus
+{
+    DISK_PENDING,
+    DISK_DONE,
+    DISK_ERROR
+};
+
+// 缓冲区中物理地址连续的一段，不跨越物理页
+struct DiskSegment
+{
+    int paddr;
+    int length;
+};
+
+// 总线主控DMA的物理区域描述符(PRD)，描述一段物理地址连续、不跨越64KB边界的缓冲区
+struct DiskPRD
+{
+    uint32 paddr;
+    uint16 length; // 字节数，0表示64KB
+    uint16 flags;  // 第15位表示最后一个描述符
+};
+
+// 一次连续扇区的读写请求，由发起请求的线程在栈上分配
+// 缓冲区在提交时转换为物理地址，中断处理函数在任何地址空间中都能访问
+struct DiskRequest
+{
+    ListItem tagInQueue;
+    int sector;    // 起始逻辑扇区号
+    int count;     // 扇区数
+    bool write;    // 写入为true，读出为false
+    bool polling;  // 以轮询方式完成，不使用中断
+    bool dma;      // 由总线主控DMA直接在硬盘和缓冲区之间传输
+    DiskSegment segments[DISK_MAX_SEGMENTS];
+    int segmentCount;
+    int done;      // 已经通过数据端口传输的扇区数
+    int segment;   // 下一个字节所在的段
+    int offset;    // 下一个字节在段内的偏移
+    volatile int status;
+    WaitQueue waiter; // 发起请求的线程在此等待请求完成
+};
+
+// IDE主通道主盘的驱动，LBA28寻址
+// 请求按提交顺序排队，由IRQ14完成当前请求并启动下一个，发起请求的线程睡眠等待，传输期间其他线程可以运行
+// 找到支持总线主控的IDE控制器时，请求按缓冲区的物理页生成PRD表，由DMA直接读写目标页框，整个请求只产生一次中断
+// 没有这样的控制器、缓冲区不满足DMA的对齐要求或者以轮询方式完成的请求使用PIO传输
+// 调度器运行前和空闲线程中不能睡眠，以轮询方式完成
 class Disk
 {
 private:
     Disk();
 
 public:
+    // 查找总线主控IDE控制器，设置IRQ14的处理函数并开启该中断，需在内存管理器初始化后调用
+    static void initialize();
+
     // 以扇区为单位写入，每次写入一个扇区
     // 参数 start: 起始逻辑扇区号
     // 参数 buf: 待写入的数据的起始地址
-    static void write(int start, void *buf)
-    {
-        byte *buffer = (byte *)buf;
-        int temp = 0;
-        int high, low;
-
-        // 请求硬盘写入一个扇区，等待硬盘就绪
-        bool flag = waitForDisk(start, 1, 0x30);
-        if (!flag)
-        {
-            return;
-        }
-
-        for (int i = 0; i < SECTOR_SIZE; i += 2)
-        {
-            high = buffer[i+1];
-            high = high & 0xff;
-            high = high << 8;
-
-            low = buffer[i];
-            low = low & 0xff;
-
-            temp = high | low;
-
-            // 每次需要向0x1f0写入一个字（2个字节）            
-            asm_outw_port(0x1f0, temp);
-            // 硬盘的状态可以从0x1F7读入
-            // 最低位是err位
-            asm_in_port(0x1f7, (uint8 *)&temp);
-            
-            if (temp & 0x1)
-            {
-                asm_in_port(0x1f1, (uint8 *)&temp);
-                printf("disk error, error code: %x\n", (temp & 0xff));
-                return;
-            }
-        }
-
-        busyWait();
-    }
+    // 成功返回true
+    static bool write(int start, void *buf);
 
     // 以扇区为单位读出，每次读取一个扇区
     // 参数 start: 起始逻辑扇区号
     // 参数 buf: 读出的数据写入的起始地址
-    static void read(int start, void *buf)
-    {
-        byte *buffer = (byte *)buf;
-        int temp;
-
-        // 请求硬盘读出一个扇区，等待硬盘就绪
-        bool flag = waitForDisk(start, 1, 0x20);
-        if (!flag)
-        {
-            return;
-        }
-
-        for (int i = 0; i < SECTOR_SIZE; i += 2)
-        {
-            // 从0x1f0读入一个字
-            asm_inw_port(0x1f0, buffer + i);
-            // 硬盘的状态可以从0x1F7读入
-            // 最低位是err位
-            asm_in_port(0x1f7, (uint8 *)&temp);
-            if (temp & 0x1)
-            {
-                asm_in_port(0x1f1, (uint8 *)&temp);
-                printf("disk error, error code: %x\n", (temp & 0xff));
-                return;
-            }
-        }
-
-        busyWait();
-    }
+    // 成功返回true
+    static bool read(int start, void *buf);
+
+    // 从start开始连续写入count个扇区，传输期间buf所在的页被换入并固定
+    static bool write(int start, int count, void *buf);
+
+    // 从start开始连续读出count个扇区，传输期间buf所在的页被换入并固定
+    static bool read(int start, int count, void *buf);
+
+    // 缓冲区为从物理地址paddr开始的连续物理内存，不需要映射，由调用者保证传输期间不被释放
+    static bool writePhysical(int start, int count, int paddr);
+    static bool readPhysical(int start, int count, int paddr);
+
+    // 根据硬盘状态推进当前请求，由IRQ14的处理函数调用，轮询时也调用
+    // 调用者需关中断
+    static void service();
 
 private:
-    // 请求硬盘读取或写入数据，等待硬盘就绪
-    // 参数 start: 待读取或写入的起始扇区的地址
-    // 参数 amount: 读取或写入的扇区数量
-    // 参数 type: 读取或写入的标志，读取=0x20，写入=0x30
-    static bool waitForDisk(int start, int amount, int type)
-    {
-        int temp;
-
-        temp = start;
-
-        // 将要读取的扇区数量写入0x1F2端口
-        asm_out_port(0x1f2, amount);
-
-        // LBA地址7~0
-        asm_out_port(0x1f3, temp & 0xff);
-
-        // LBA地址15~8
-        temp = temp >> 8;
-        asm_out_port(0x1f4, temp & 0xff);
-
-        // LBA地址23~16
-        temp = temp >> 8;
-        asm_out_port(0x1f5, temp & 0xff);
-
-        // LBA地址27~24
-        temp = temp >> 8;
-        asm_out_port(0x1f6, (temp & 0xf) | 0xe0);
-
-        // 向0x1F7端口写入操作类型，读取=0x20，写入=0x30
-        asm_out_port(0x1f7, type);
-
-        asm_in_port(0x1f7, (uint8 *)&temp);
-        while ((temp & 0x88) != 0x8)
-        {
-            // 读入硬盘状态
-            if (temp & 0x1)
-            {
-                // 错误码
-                asm_in_port(0x1f1, (uint8 *)&temp);
-                printf("disk error, error code: %x\n", (temp & 0xff));
-                return false;
-            }
-            asm_in_port(0x1f7, (uint8 *)&temp);
-        }
-        return true;
-    }
-
-    static void busyWait() {
-        uint temp = 0xfffff;
-        while(temp) --temp;
-    }
+    // 等待的请求，不包括正在传输的
+    static IntrusiveList<DiskRequest, &DiskRequest::tagInQueue> queue;
+    // 正在传输的请求
+    static DiskRequest *current;
+    // 中断处理函数访问缓冲区所在物理页的窗口
+    static int window;
+    // 数据端口和缓冲区之间中转一个扇区
+    static byte sectorBuffer[SECTOR_SIZE];
+    // 主通道总线主控寄存器的I/O基址，0表示不支持DMA
+    static int busMaster;
+    // PRD表的物理地址
+    static int prdTableAddress;
+
+    // 将buf开始的count个扇区的缓冲区拆分成请求并提交
+    static bool transfer(int start, int count, void *buf, bool write);
+    static bool transferPhysical(int start, int count, int paddr, bool write);
+    // 将物理地址paddr开始的length个字节按物理页加入请求的缓冲区
+    static void addSegment(DiskRequest *request, int paddr, int length);
+    // 提交请求并等待完成，成功返回true
+    static bool submit(DiskRequest *request, int start, int count, bool write);
+    // 启动队列中的下一个请求
+    static void startNext();
+    // 向硬盘发出请求的命令
+    static void start(DiskRequest *request);
+    // 以status结束当前请求并启动下一个
+    static void finish(int status);
+    // 当前请求超时，复位硬盘后以错误结束
+    static void cancel(DiskRequest *request);
+    // 通过PCI配置空间找到IDE控制器并开启总线主控
+    static void initializeDMA();
+    // 请求能否使用DMA传输
+    static bool canDMA(DiskRequest *request);
+    // 按请求的缓冲区填写PRD表并设置传输方向
+    static void prepareDMA(DiskRequest *request);
+    // DMA请求的中断处理
+    static void serviceDMA();
+    // 在sectorBuffer和请求的缓冲区之间复制一个扇区
+    static void copySector(DiskRequest *request, bool toDisk);
+    // 读4次备用状态寄存器，等待状态寄存器有效
+    static void delay();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,43 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include "intrusive_list.h"
+#include "os_type.h"
+
+struct EpochNode;
+
+// 宽限期结束后释放对象的回调函数
+typedef void (*EpochCallback)(EpochNode *node);
+
+// 嵌入到待延迟释放的对象中
+struct EpochNode
+{
+    ListItem tag;
+    EpochCallback callback;
+};
+
+// 基于纪元的延迟释放
+// 读者进入临界区时登记在当前纪元上，之后可以在开中断的情况下遍历线程队列和页表；
+// 写者从队列中摘下对象后将其挂到当前纪元的回收队列，
+// 等上一纪元的读者全部离开、纪元推进两次后才真正释放
+class EpochManager
+{
+private:
+    volatile uint32 epoch;       // 当前纪元
+    volatile uint32 readers[2];  // 按纪元奇偶登记的读者数量
+    IntrusiveList<EpochNode, &EpochNode::tag> retired[2]; // 按纪元奇偶登记的待释放对象
+
+public:
+    EpochManager();
+    void initialize();
+    // 进入读临界区，返回读者登记的槽位，临界区内不能阻塞
+    uint32 readLock();
+    // 离开读临界区，slot为readLock的返回值
+    void readUnlock(uint32 slot);
+    // 对象已从所有队列中摘下，宽限期结束后调用callback释放
+    void retire(EpochNode *node, EpochCallback callback);
+    // 由调度器在关中断时调用，上一纪元的读者都已离开时释放对象并推进纪元
+    void poll();
+};
+
+#endif
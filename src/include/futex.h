@@ -0,0 +1,31 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "list.h"
+#include "sync.h"
+
+// futex散列表的桶数
+const int FUTEX_HASH_SIZE = 64;
+
+class FutexManager
+{
+private:
+    // 阻塞的线程按futex的物理地址散列到各个桶中，不同进程共享同一物理页时也能相互唤醒
+    WaitQueue buckets[FUTEX_HASH_SIZE];
+    SpinLock futexLock;
+
+public:
+    FutexManager();
+    void initialize();
+    // *address == expected时阻塞当前线程，被唤醒返回0，超过timeout微秒返回-2；否则或address无效时返回-1
+    // 等待期间futex所在的物理页被固定，按物理地址散列
+    int wait(int *address, int expected, int timeout);
+    // 唤醒至多count个阻塞在address上的线程，返回唤醒的线程数
+    int wake(int *address, int count);
+
+private:
+    // address是否为按4字节对齐的用户地址
+    bool validAddress(int *address);
+};
+
+#endif
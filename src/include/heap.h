@@ -0,0 +1,153 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+// 嵌入到堆中元素的结点，记录元素在堆数组中的位置
+struct HeapNode
+{
+    int index; // 在堆数组中的下标加1，0表示不在堆中
+};
+
+// 侵入式二叉最小堆，元素为T类型的对象，通过其中的HeapNode成员Member记录位置
+// Traits::less(a, b)返回a是否应排在b之前
+// 容量为N，插入、删除任意元素都是O(log N)
+template <typename T, HeapNode T::*Member, typename Traits, int N>
+class IntrusiveHeap
+{
+private:
+    T *nodes[N];
+    int count;
+
+public:
+    void initialize()
+    {
+        count = 0;
+    }
+
+    bool empty()
+    {
+        return count == 0;
+    }
+
+    int size()
+    {
+        return count;
+    }
+
+    // 返回堆顶元素，堆为空时返回nullptr
+    T *top()
+    {
+        return count ? nodes[0] : nullptr;
+    }
+
+    bool contains(T *object)
+    {
+        return (object->*Member).index != 0;
+    }
+
+    // 堆已满时返回false
+    bool push(T *object)
+    {
+        if (count == N)
+        {
+            return false;
+        }
+
+        place(object, count++);
+        siftUp(count - 1);
+        return true;
+    }
+
+    // 取出堆顶元素，堆为空时返回nullptr
+    T *pop()
+    {
+        T *object = top();
+        if (object)
+        {
+            erase(object);
+        }
+        return object;
+    }
+
+    void erase(T *object)
+    {
+        int index = (object->*Member).index - 1;
+        (object->*Member).index = 0;
+
+        --count;
+        if (index == count)
+        {
+            return;
+        }
+
+        // 用最后一个元素填补空位，再向上或向下调整
+        place(nodes[count], index);
+        update(nodes[index]);
+    }
+
+    // object的键值改变后恢复堆的性质
+    void update(T *object)
+    {
+        int index = (object->*Member).index - 1;
+        if (index > 0 && Traits::less(object, nodes[(index - 1) / 2]))
+        {
+            siftUp(index);
+        }
+        else
+        {
+            siftDown(index);
+        }
+    }
+
+private:
+    void place(T *object, int index)
+    {
+        nodes[index] = object;
+        (object->*Member).index = index + 1;
+    }
+
+    void siftUp(int index)
+    {
+        T *object = nodes[index];
+
+        while (index > 0)
+        {
+            int parent = (index - 1) / 2;
+            if (!Traits::less(object, nodes[parent]))
+            {
+                break;
+            }
+            place(nodes[parent], index);
+            index = parent;
+        }
+
+        place(object, index);
+    }
+
+    void siftDown(int index)
+    {
+        T *object = nodes[index];
+
+        while (true)
+        {
+            int child = 2 * index + 1;
+            if (child >= count)
+            {
+                break;
+            }
+            if (child + 1 < count && Traits::less(nodes[child + 1], nodes[child]))
+            {
+                ++child;
+            }
+            if (!Traits::less(nodes[child], object))
+            {
+                break;
+            }
+            place(nodes[child], index);
+            index = child;
+        }
+
+        place(object, index);
+    }
+};
+
+#endif
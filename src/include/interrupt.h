@@ -24,6 +24,15 @@ public:
     void disableTimeInterrupt();
     // 设置时钟中断处理函数
     void setTimeInterrupt(void *handler);
+    // 设置8253/8254 PIT通道0的输出频率，即时钟中断频率
+    // frequency 时钟中断频率，Hz
+    void setTimerFrequency(uint32 frequency);
+    // 开启8259A的第irq号中断，irq=0, 1, ..., 15，从片的中断同时开启主片的IRQ2
+    void enableIRQ(uint32 irq);
+    // 屏蔽8259A的第irq号中断
+    void disableIRQ(uint32 irq);
+    // 设置第irq号中断的处理函数
+    void setIRQHandler(uint32 irq, void *handler);
 
     // 开中断
     void enableInterrupt();
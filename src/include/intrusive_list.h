@@ -0,0 +1,223 @@
+#ifndef INTRUSIVE_LIST_H
+#define INTRUSIVE_LIST_H
+
+#include "list.h"
+#include "os_type.h"
+
+// 由链表元素item得到包含它的T类型对象，Member为T中的ListItem成员，item为nullptr时返回nullptr
+template <typename T, ListItem T::*Member>
+inline T *list_entry(ListItem *item)
+{
+    return item ? (T *)((char *)item - (char *)&(((T *)0)->*Member)) : nullptr;
+}
+
+// 带头结点的循环双向链表，记录元素个数，除遍历外的操作都是O(1)
+// 头结点指向自身表示空链表，使用前必须调用initialize
+// 删除元素时不修改该元素的next，开中断遍历的读者在宽限期内可以从被删除的元素继续遍历
+class ListHead
+{
+protected:
+    ListItem head;
+    uint32 count;
+
+public:
+    void initialize()
+    {
+        head.next = head.previous = &head;
+        count = 0;
+    }
+
+    bool empty()
+    {
+        return head.next == &head;
+    }
+
+    int size()
+    {
+        return count;
+    }
+
+    // 返回第一个元素，空链表返回nullptr
+    ListItem *front()
+    {
+        return head.next == &head ? nullptr : head.next;
+    }
+
+    // 返回最后一个元素，空链表返回nullptr
+    ListItem *back()
+    {
+        return head.previous == &head ? nullptr : head.previous;
+    }
+
+    // 返回item的下一个元素，item是最后一个元素时返回nullptr
+    ListItem *next(ListItem *item)
+    {
+        return item->next == &head ? nullptr : item->next;
+    }
+
+    // 返回item的上一个元素，item是第一个元素时返回nullptr
+    ListItem *previous(ListItem *item)
+    {
+        return item->previous == &head ? nullptr : item->previous;
+    }
+
+    // 将item插入到position之前
+    void insert(ListItem *position, ListItem *item)
+    {
+        // 先初始化新元素再链入，开中断遍历的读者不会看到未初始化的指针
+        item->next = position;
+        item->previous = position->previous;
+        position->previous->next = item;
+        position->previous = item;
+        ++count;
+    }
+
+    void push_front(ListItem *item)
+    {
+        insert(head.next, item);
+    }
+
+    void push_back(ListItem *item)
+    {
+        insert(&head, item);
+    }
+
+    void erase(ListItem *item)
+    {
+        item->previous->next = item->next;
+        item->next->previous = item->previous;
+        --count;
+    }
+
+    void pop_front()
+    {
+        if (!empty())
+        {
+            erase(head.next);
+        }
+    }
+
+    void pop_back()
+    {
+        if (!empty())
+        {
+            erase(head.previous);
+        }
+    }
+
+    // 将other的全部元素按原顺序移到链表的头部，other变为空
+    void splice_front(ListHead *other)
+    {
+        if (other->empty())
+        {
+            return;
+        }
+
+        ListItem *first = other->head.next;
+        ListItem *last = other->head.previous;
+
+        last->next = head.next;
+        head.next->previous = last;
+        first->previous = &head;
+        head.next = first;
+
+        count += other->count;
+        other->initialize();
+    }
+
+    // 将other的全部元素按原顺序移到链表的尾部，other变为空
+    void splice_back(ListHead *other)
+    {
+        if (other->empty())
+        {
+            return;
+        }
+
+        ListItem *first = other->head.next;
+        ListItem *last = other->head.previous;
+
+        first->previous = head.previous;
+        head.previous->next = first;
+        last->next = &head;
+        head.previous = last;
+
+        count += other->count;
+        other->initialize();
+    }
+};
+
+// 类型化的侵入式链表，元素为T类型的对象，通过其中的ListItem成员Member链接
+template <typename T, ListItem T::*Member>
+class IntrusiveList : public ListHead
+{
+public:
+    static T *entry(ListItem *item)
+    {
+        return list_entry<T, Member>(item);
+    }
+
+    T *front()
+    {
+        return entry(ListHead::front());
+    }
+
+    T *back()
+    {
+        return entry(ListHead::back());
+    }
+
+    T *next(T *object)
+    {
+        return entry(ListHead::next(&(object->*Member)));
+    }
+
+    T *previous(T *object)
+    {
+        return entry(ListHead::previous(&(object->*Member)));
+    }
+
+    // 将object插入到position之前，position为nullptr时插入到尾部
+    void insert(T *position, T *object)
+    {
+        ListHead::insert(position ? &(position->*Member) : &head, &(object->*Member));
+    }
+
+    void push_front(T *object)
+    {
+        ListHead::push_front(&(object->*Member));
+    }
+
+    void push_back(T *object)
+    {
+        ListHead::push_back(&(object->*Member));
+    }
+
+    void erase(T *object)
+    {
+        ListHead::erase(&(object->*Member));
+    }
+
+    // 取出第一个元素，空链表返回nullptr
+    T *pop_front()
+    {
+        T *object = front();
+        if (object)
+        {
+            ListHead::erase(&(object->*Member));
+        }
+        return object;
+    }
+
+    // 取出最后一个元素，空链表返回nullptr
+    T *pop_back()
+    {
+        T *object = back();
+        if (object)
+        {
+            ListHead::erase(&(object->*Member));
+        }
+        return object;
+    }
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#include "os_type.h"
+
+// 锁统计，编译时定义LOCKSTAT后开启
+// 记录每个命名锁的获得次数、竞争次数、等待时间和持有时间，时间以TSC周期为单位
+struct LockStat
+{
+    const char *name;     // 锁的名称，为nullptr时不参与输出
+    uint32 acquisitions;  // 获得锁的次数
+    uint32 contentions;   // 需要自旋或阻塞才获得锁的次数
+    uint64 waitCycles;    // 自旋或阻塞等待的总周期数
+    uint64 holdCycles;    // 持有锁的总周期数
+    uint64 maxHoldCycles; // 最长的一次持有周期数
+    uint64 acquireTime;   // 最近一次获得锁时的TSC
+    LockStat *next;       // 已注册的下一个锁
+};
+
+// 清空统计，name不为nullptr时注册到输出列表，注册后的锁不能被释放
+void lockstat_initialize(LockStat *stat, const char *name);
+// 获得锁时调用，contended表示是否经过了等待，waitCycles为等待的周期数
+void lockstat_acquired(LockStat *stat, bool contended, uint64 waitCycles);
+// 释放锁时调用
+void lockstat_released(LockStat *stat);
+// 输出所有已注册的锁的统计
+void lockstat_print();
+
+#endif
@@ -2,6 +2,15 @@
 #define MEMORY_H
 
 #include "address_pool.h"
+#include "slab.h"
+#include "radix_tree.h"
+#include "page_frame.h"
+#include "intrusive_list.h"
+
+struct PageMeta;
+
+// 预清零队列的容量
+const int ZEROED_POOL_SIZE = 32;
 
 enum AddressPoolType
 {
@@ -14,29 +23,81 @@ class MemoryManager
 public:
     // 可管理的内存容量
     int totalMemory;
-    // 内核物理地址池
-    AddressPool kernelPhysical;
-    // 用户物理地址池
-    AddressPool userPhysical;
+    // 物理页分配器，内核和用户共用一个位图
+    BitMap physicalPages;
+    int physicalStartAddress;
+    // 按用途统计已分配的物理页数，下标为AddressPoolType
+    int usedPages[2];
+    // 按用途的软配额，空闲物理页充足时可以超出，物理页用完时优先换出超出配额一方的页
+    int pageQuota[2];
     // 内核虚拟地址池
     AddressPool kernelVirtual;
     // 换出交换区的起始扇区
     int beginSector;
     //交换资源的管理
     BitMap swapResources;
+    // CPU是否支持并开启了全局页
+    bool globalPages;
+    // 用户地址空间VMA的缓存
+    SlabCache vmaCache;
+    // 基数树结点的缓存
+    SlabCache radixNodeCache;
+    // 页元数据的缓存
+    SlabCache pageMetaCache;
+    // 内核虚拟页号到PageMeta的映射
+    RadixTree kernelPageMeta;
+    // 页框数据库，frames[i]描述页框号为firstFrame + i的物理页，覆盖两个物理地址池
+    Page *frames;
+    uint32 firstFrame;
+    uint32 frameCount;
+    // 全局的用户页LRU近似队列，刚映射和最近访问过的页在active中，换出的页从inactive的头部选取
+    IntrusiveList<Page, &Page::tagInLRU> activePages;
+    IntrusiveList<Page, &Page::tagInLRU> inactivePages;
+    // 用于临时映射其他进程的页表和物理页的内核虚拟页
+    int pageTableWindow;
+    int frameWindow;
+    // 空闲线程预先清零的物理页，不计入任何用途的使用量
+    IntrusiveList<Page, &Page::tagInLRU> zeroedPages;
+    // 空闲线程清零物理页时使用的窗口，只在空闲线程中使用，可以开中断
+    int zeroWindow;
 public:
     MemoryManager();
 
     // 初始化地址池
     void initialize();
 
-    // 从type类型的物理地址池中分配count个连续的页
+    // 为type用途分配count个连续的物理页，计入该用途的使用量
     // 成功，返回起始地址；失败，返回0
     int allocatePhysicalPages(enum AddressPoolType type, const int count);
 
-    // 释放从paddr开始的count个物理页
+    // 为type用途分配一个内容全为0的物理页，优先取预清零的页，成功返回物理地址，失败返回0
+    int allocateZeroedPage(enum AddressPoolType type);
+
+    // 由空闲线程调用，清零一个空闲物理页放入预清零队列，队列已满或没有空闲页时返回false
+    bool refillZeroedPage();
+
+    // 释放从paddr开始的count个物理页，每页只减少一次引用，引用为0时才归还到所属的地址池
     void releasePhysicalPages(enum AddressPoolType type, const int startAddress, const int count);
 
+    // 返回物理地址paddr所在页框的描述符，不在物理地址池中时返回nullptr
+    Page *paddrToPage(const int paddr);
+
+    // 返回页框描述符对应的物理地址
+    int pageToPaddr(Page *page);
+
+    // 增加物理页的引用，共享该页的每一方各自用releasePhysicalPages释放
+    void getPhysicalPage(const int paddr);
+
+    // 使当前地址空间的虚拟页vaddr驻留在内存中并增加其物理页的引用，I/O期间该页不会被换出或重新分配
+    // 成功返回物理页的地址，页无法换入时返回0
+    int pinPage(const int vaddr);
+
+    // 释放pinPage增加的引用，页在此期间被释放时归还该页
+    void unpinPage(const int paddr);
+
+    // 记录物理页被owner的虚拟页vaddr映射，owner为nullptr表示内核
+    void mapPhysicalPage(const int paddr, PCB *owner, const int vaddr);
+
     // 获取内存总容量
     int getTotalMemory();
 
@@ -49,7 +110,7 @@ public:
     // 虚拟页分配
     int allocateVirtualPages(enum AddressPoolType type, const int count);
 
-    // 建立虚拟页到物理页的联系
+    // 建立虚拟页到物理页的联系，内核虚拟页标记为全局页
     bool connectPhysicalVirtualPage(const int virtualAddress, const int physicalPageAddress);
 
     // 计算virtualAddress的页目录项的虚拟地址
@@ -58,9 +119,19 @@ public:
     // 计算virtualAddress的页表项的虚拟地址
     int toPTE(const int virtualAddress);
 
+    // 内核虚拟页的映射发生变化后刷新其TLB表项，全局页不会因重新加载CR3而刷新
+    void flushKernelPage(const int virtualAddress);
+
     // 页内存释放
     void releasePages(enum AddressPoolType type, const int virtualAddress, const int count);    
 
+    // 分配count个常驻的内核页，不在LRU中记录，不会被换出，用于PCB、页目录表等
+    // zeroed为true时内容清零，成功返回起始虚拟地址，失败返回0
+    int allocatePinnedPages(const int count, bool zeroed = false);
+
+    // 释放allocatePinnedPages分配的页
+    void releasePinnedPages(const int virtualAddress, const int count);
+
     // 找到虚拟地址对应的物理地址
     int vaddr2paddr(int vaddr);
 
@@ -69,6 +140,52 @@ public:
     // 换入换出
     int swapOut(uint32 vaddr, int mod);
     int swapIn(uint32 vaddr, int mod);
+
+    // 将物理页page的内容写回交换区从sector开始的8个扇区，page为nullptr时只写回
+    // 等待硬盘期间可能睡眠，页在此期间被释放时归还该页并返回1
+    // 写回成功且页没有被再次写过返回0，否则返回-1
+    int writeBack(Page *page, int paddr, uint32 vaddr, int sector);
+
+    // 物理页用完时换出一页，成功返回0，失败返回-1
+    int reclaimPhysicalPage();
+
+    // 换出用户物理页page，通过反向映射找到并清除映射它的页表项
+    int swapOutPage(Page *page);
+
+    // 释放页目录表pageDir的用户部分映射的物理页和页表，页目录表可以不属于当前进程
+    void releaseUserPages(int *pageDir);
+
+    // 将page从所在的LRU队列中摘下
+    void unlinkPage(Page *page);
+
+    // 返回page最近是否被访问过，并清除其访问位
+    bool testAndClearAccessed(Page *page);
+
+    // 按二次机会从inactive队列中选出最近未被访问的用户页，没有可换出的页时返回nullptr
+    Page *selectVictim();
+
+    // 返回映射page的页表项的地址，页表不在当前地址空间时通过窗口临时映射
+    int *rmapPTE(Page *page);
+
+    // 将内核虚拟页window映射到物理页paddr，返回window
+    void *mapWindow(int window, int paddr);
+
+    // 为虚拟页vaddr分配交换区并返回其元数据，失败返回nullptr
+    PageMeta *prepareSwapSlot(RadixTree *tree, uint32 vaddr);
+
+    // type类型的虚拟页所属的元数据基数树，用户页属于当前进程
+    RadixTree *pageMetaTree(enum AddressPoolType type);
+
+    // 返回虚拟页vaddr的元数据，不存在时返回nullptr
+    // 调用者需关中断或处于纪元读临界区
+    PageMeta *lookupPageMeta(enum AddressPoolType type, const uint32 vaddr);
+
+    // 删除虚拟页vaddr的元数据并归还其交换区
+    void dropPageMeta(enum AddressPoolType type, const uint32 vaddr);
+
+    // 将交换区中从index开始的页复制到新分配的交换区，buffer为一页的缓冲区
+    // 成功返回新的位置，失败返回-1
+    int copySwapSlot(const int index, char *buffer);
 };
 
 #endif
\ No newline at end of file
@@ -6,7 +6,6 @@
 #define STACK_SELECTOR 0x10
 
 #define MAX_PROGRAM_NAME 16
-#define MAX_PROGRAM_AMOUNT 16
 
 #define MEMORY_SIZE_ADDRESS 0xc0007c00
 #define PAGE_SIZE 4096
@@ -28,4 +27,13 @@
 
 #define USER_VADDR_START 0x8048000
 
+// 8253/8254 PIT的输入时钟频率，Hz
+#define PIT_FREQUENCY 1193182
+// 时钟中断频率，Hz，可在100~1000之间配置
+#define TIMER_FREQUENCY 100
+#define MIN_TIMER_FREQUENCY 100
+#define MAX_TIMER_FREQUENCY 1000
+// 每一级优先级对应的时间片长度，单位为微秒
+#define TIME_SLICE_UNIT 10000
+
 #endif
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include "memory.h"
 #include "syscall.h"
 #include "tss.h"
+#include "clock.h"
+#include "futex.h"
+#include "epoch.h"
 
 extern InterruptManager interruptManager;
 extern STDIO stdio;
@@ -14,5 +17,8 @@ extern ProgramManager programManager;
 extern MemoryManager memoryManager;
 extern SystemService systemService;
 extern TSS tss;
+extern SystemClock systemClock;
+extern FutexManager futexManager;
+extern EpochManager epochManager;
 
 #endif
\ No newline at end of file
@@ -12,4 +12,6 @@ typedef unsigned int uint32;
 typedef unsigned int uint;
 typedef unsigned int dword;
 
+typedef unsigned long long uint64;
+
 #endif
\ No newline at end of file
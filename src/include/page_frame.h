@@ -0,0 +1,31 @@
+#ifndef PAGE_FRAME_H
+#define PAGE_FRAME_H
+
+#include "list.h"
+#include "os_type.h"
+
+struct PCB;
+
+enum PageFrameFlags
+{
+    PG_KERNEL = 1 << 0,   // 属于内核物理地址池
+    PG_USER = 1 << 1,     // 属于用户物理地址池
+    PG_TABLE = 1 << 2,    // 用作页表
+    PG_LRU = 1 << 3,      // 在页面置换的LRU队列中
+    PG_RESERVED = 1 << 4, // 启动时已占用(如页框数据库本身)，不参与置换
+    PG_ACTIVE = 1 << 5,   // 在active队列中，否则在inactive队列中
+    PG_ZERO = 1 << 6      // 已清零，在预清零队列中等待分配
+};
+
+// 物理页框的描述符，MemoryManager::frames按页框号索引
+struct Page
+{
+    uint16 refcount; // 引用计数，0表示空闲
+    uint16 mapcount; // 指向该页的页表项个数
+    uint32 flags;    // PageFrameFlags的组合
+    ListItem tagInLRU;
+    PCB *owner;      // 反向映射：映射该页的进程，内核页为nullptr
+    uint32 vpn;      // 反向映射：映射该页的虚拟页号
+};
+
+#endif
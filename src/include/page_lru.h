@@ -0,0 +1,34 @@
+#ifndef PAGE_LRU_H
+#define PAGE_LRU_H
+
+#include "os_type.h"
+
+const int MAX_PAGES = 200;
+
+// 记录已分配的页及其最近访问时间，用于选出换出的页
+class PageLRU
+{
+public:
+    int startAddress;
+    // lru队列
+    int lrucnt[MAX_PAGES];
+    // 用于记录对应页的索引
+    int lruindex[MAX_PAGES];
+    // 局部时钟
+    int clock;
+public:
+    // 清空记录，页的索引相对于startAddress计算
+    void initializeLRU(const int startAddress);
+    // 记录从第start页开始的count个页
+    void track(const int start, const int count);
+    // 删除从第start页开始的count个页的记录
+    void untrack(const int start, const int count);
+    // 返回第index页的记录在数组中的位置，没有记录时返回-1
+    int find(const int index);
+    // 更新LRU数组
+    void LRU();
+    // 返回本周期内未被访问且最久未被访问的页的虚拟地址，没有这样的页时返回-1
+    int Out();
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include "os_type.h"
+
+// 配置空间中常用寄存器的偏移
+const uint8 PCI_VENDOR_ID = 0x00;   // 低16位为厂商号，高16位为设备号
+const uint8 PCI_COMMAND = 0x04;     // 低16位为命令寄存器
+const uint8 PCI_CLASS = 0x08;       // 类别码、子类别码、编程接口和版本号
+const uint8 PCI_HEADER_TYPE = 0x0c; // 第16~23位为头部类型
+const uint8 PCI_BAR4 = 0x20;
+
+// 命令寄存器
+const uint16 PCI_COMMAND_IO = 0x1;         // 响应I/O空间的访问
+const uint16 PCI_COMMAND_BUS_MASTER = 0x4; // 允许设备作为总线主控访问内存
+
+// PCI设备的位置
+struct PCIAddress
+{
+    uint8 bus;
+    uint8 device;
+    uint8 function;
+};
+
+// 通过0xCF8/0xCFC端口(配置机制1)读写配置空间中offset处的32位寄存器，offset按4字节对齐
+uint32 pci_config_read(PCIAddress *address, uint8 offset);
+void pci_config_write(PCIAddress *address, uint8 offset, uint32 value);
+
+// 查找第一个类别码为classCode、子类别码为subclass的设备，找到返回true
+bool pci_find_class(uint8 classCode, uint8 subclass, PCIAddress *address);
+
+#endif
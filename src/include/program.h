@@ -1,20 +1,71 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H
 
-#include "list.h"
+#include "intrusive_list.h"
+#include "heap.h"
 #include "thread.h"
+#include "ring_buffer.h"
 
-#define ListItem2PCB(ADDRESS, LIST_ITEM) ((PCB *)((int)(ADDRESS) - (int)&((PCB *)0)->LIST_ITEM))
+// 实时优先级的级数
+const int MAX_RT_PRIORITY = 32;
+
+// pid散列表的桶数
+const int PID_HASH_SIZE = 64;
+// pid的最大值，超过后从1开始重新分配
+const int MAX_PID = 32768;
+// 唤醒延迟样本缓冲区的容量
+const int LATENCY_RING_SIZE = 64;
+
+// 调度器发布的一个唤醒延迟样本
+struct LatencySample
+{
+    uint32 generation; // 产生样本时的统计代数，旧代数的样本在统计时丢弃
+    uint32 latency;    // ns
+};
+// 同时设置了超时的阻塞线程的最大数量
+const int MAX_TIMEOUTS = 1024;
+
+// 超时堆按超时时刻排列
+struct TimeoutOrder
+{
+    static bool less(PCB *a, PCB *b)
+    {
+        return a->timeout < b->timeout;
+    }
+};
 
 class ProgramManager
 {
 public:
-    List allPrograms;        // 所有状态的线程/进程的队列
-    List readyPrograms;      // 处于ready(就绪态)的线程/进程的队列
+    IntrusiveList<PCB, &PCB::tagInAllList> allPrograms; // 所有状态的线程/进程的队列
+    ProgramList readyPrograms;      // 处于ready(就绪态)的线程/进程的队列
+    ProgramList realtimePrograms[MAX_RT_PRIORITY]; // 处于就绪态的实时线程，每个实时优先级一个队列
+    uint32 realtimeBitmap;   // 第i位为1表示realtimePrograms[i]非空
+    ProgramList freePrograms;       // 已释放、可重用的PCB的队列
+    // 设置了超时的阻塞线程，堆顶为最早超时的线程
+    IntrusiveHeap<PCB, &PCB::tagInTimeoutHeap, TimeoutOrder, MAX_TIMEOUTS> timeoutHeap;
+    IntrusiveList<PCB, &PCB::tagInPidHash> pidHash[PID_HASH_SIZE]; // pid到PCB的散列表
+    int nextPid;             // 下一个待分配的pid
     PCB *running;            // 当前执行的线程
+    PCB *idle;               // 空闲线程，不在就绪队列中，没有其他线程可运行时执行
     int USER_CODE_SELECTOR;  // 用户代码段选择子
     int USER_DATA_SELECTOR;  // 用户数据段选择子
     int USER_STACK_SELECTOR; // 用户栈段选择子
+    int loadedPageDirectory; // 当前CR3中的页目录表物理地址
+
+    bool latencyTrace;        // 是否测量实时线程的唤醒延迟
+    // 统计代数，setLatencyTrace清空统计时加一，由消费者在取出样本时检查
+    volatile uint32 latencyGeneration;
+    // 调度器是唯一的生产者，printLatencyTrace是唯一的消费者
+    SPSCRing<LatencySample, LATENCY_RING_SIZE> latencyRing;
+    // 因latencyRing已满而丢弃的样本数，只由调度器修改
+    volatile uint32 latencyDropped;
+    // 以下只由消费者修改
+    uint32 latencyConsumed;    // 当前统计所属的代数
+    uint32 latencyDroppedBase; // 当前统计开始时的latencyDropped
+    uint32 latencySamples;     // 唤醒延迟的样本数
+    uint64 totalLatency;       // 唤醒延迟之和，ns
+    uint64 maxLatency;         // 最大唤醒延迟，ns
 public:
     ProgramManager();
     void initialize();
@@ -31,16 +82,57 @@ public:
 
     // 分配一个PCB
     PCB *allocatePCB();
-    // 归还一个PCB
+    // 归还一个PCB，宽限期结束后才会被重用
     // program：待释放的PCB
     void releasePCB(PCB *program);
+    // 宽限期结束后回收PCB及进程的页目录表
+    void reclaimPCB(PCB *program);
+    // 根据pid查找PCB，找不到返回nullptr
+    // 调用者需关中断或处于epoch读临界区，返回的PCB在此期间有效
+    PCB *findProgram(int pid);
+    // 打印所有线程/进程，遍历时不关中断
+    void printPrograms();
+
+    // 分配一个未被使用的pid
+    int allocatePid();
 
     // 执行线程调度
     void schedule();
 
-    // 阻塞唤醒
+    // 是否有就绪的线程
+    bool hasReady();
+
+    // 创建空闲线程，成功返回true
+    bool createIdleThread();
+
+    // 设置线程的时间片长度，单位为微秒
+    void setTimeSlice(PCB *program, int microseconds);
+
+    // 阻塞唤醒，被唤醒的实时线程优先于当前线程时立即抢占
     void MESA_WakeUp(PCB *program);
 
+    // 唤醒programs中的全部线程，普通线程整体一次移入就绪队列，programs变为空
+    void MESA_WakeUpAll(ProgramList *programs);
+
+    // 设置线程的调度策略和实时优先级
+    void setScheduler(PCB *program, enum SchedulePolicy policy, int rtPriority);
+
+    // 当前线程让出CPU给更高优先级的就绪线程，并保持在其队列的头部
+    void preempt();
+
+    // 阻塞的线程program在deadline(jiffies)时超时，超时堆已满时返回false
+    bool addTimeout(PCB *program, uint64 deadline);
+    // 取消program的超时
+    void cancelTimeout(PCB *program);
+    // 由时钟中断调用，唤醒已超时的线程
+    void expireTimeouts();
+
+    // 开启或关闭唤醒延迟测量，并清空已有的统计
+    // 只增加统计代数，已发布的样本和统计由printLatencyTrace在下次取出时丢弃
+    void setLatencyTrace(bool enable);
+    // 取出调度器发布的样本并打印唤醒延迟的统计，是latencyRing唯一的消费者
+    void printLatencyTrace();
+
     // 初始化TSS
     void initializeTSS();
 
@@ -50,12 +142,16 @@ public:
     // 创建用户页目录表
     int createProcessPageDirectory();
 
-    // 创建用户地址池
+    // 初始化用户虚拟地址空间
     bool createUserVirtualPool(PCB *process);
 
     // 切换页目录表，实现虚拟地址空间的切换
+    // 内核线程不切换页目录表，直接借用上一个线程的地址空间
     void activateProgramPage(PCB *program);
 
+    // 加载页目录表，与当前CR3相同时不重新加载
+    void loadPageDirectory(int paddr);
+
     // 创建子进程
     int fork();
 
@@ -68,9 +164,28 @@ public:
     // 等待子进程
     int wait(int *retval);
 
+private:
+    // 将线程加入其调度策略对应的就绪队列，front=true时加入队列头部
+    void enqueueReady(PCB *program, bool front);
+    // 将就绪线程从就绪队列中移除
+    void dequeueReady(PCB *program);
+    // 取出下一个要执行的线程，实时线程优先
+    PCB *pickNext();
+    // 判断就绪线程program是否应当抢占当前线程
+    bool shouldPreempt(PCB *program);
+
+    // 进程退出时通知父进程，并使自己的子进程成为孤儿进程
+    void notifyExit(PCB *program);
+    // 撤销创建失败的进程，从创建者的子进程队列和就绪队列中摘下后归还PCB
+    void discardProcess(PCB *process);
+
 };
 
 void program_exit();
+// 空闲线程执行的函数，预先清零空闲物理页，无事可做时停机等待中断
+void idle_thread(void *arg);
+// 延迟释放PCB的回调函数
+void reclaim_pcb(EpochNode *node);
 void load_process(const char *filename);
 
 #endif
\ No newline at end of file
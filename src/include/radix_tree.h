@@ -0,0 +1,49 @@
+#ifndef RADIX_TREE_H
+#define RADIX_TREE_H
+
+#include "epoch.h"
+#include "os_type.h"
+
+const int RADIX_TREE_SHIFT = 5;
+const int RADIX_TREE_SLOTS = 1 << RADIX_TREE_SHIFT;
+const int RADIX_TREE_MASK = RADIX_TREE_SLOTS - 1;
+// 4层共20位，覆盖全部虚拟页号
+const int RADIX_TREE_HEIGHT = 4;
+
+struct RadixNode
+{
+    EpochNode tagInRetired;
+    int count; // 非空槽位的个数
+    void *volatile slots[RADIX_TREE_SLOTS];
+};
+
+// 以20位整数(虚拟页号)为键的基数树，查找的代价为树高
+// 结点先初始化再链入，摘下的结点经过宽限期后才释放，
+// 查找可以在关中断或纪元读临界区内与修改并发进行，修改由调用者关中断保护
+class RadixTree
+{
+private:
+    RadixNode *volatile root;
+
+public:
+    void initialize();
+    // 返回键为key的元素，不存在时返回nullptr
+    void *lookup(uint32 key);
+    // key已存在或内存不足时返回false
+    bool insert(uint32 key, void *item);
+    // 删除并返回键为key的元素，不存在时返回nullptr
+    void *remove(uint32 key);
+    // 返回键不小于*key的第一个元素并将*key设为它的键，不存在时返回nullptr
+    void *next(uint32 *key);
+    // 释放全部结点并对每个元素调用release，调用时不能有其他读者
+    void destroy(void (*release)(void *item));
+
+private:
+    RadixNode *createNode();
+    static void *scan(RadixNode *node, int level, uint32 *key);
+    static void destroyNode(RadixNode *node, int level, void (*release)(void *item));
+};
+
+void reclaim_radix_node(EpochNode *node);
+
+#endif
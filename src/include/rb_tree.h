@@ -0,0 +1,428 @@
+#ifndef RB_TREE_H
+#define RB_TREE_H
+
+// 嵌入到红黑树元素中的结点
+struct RBNode
+{
+    RBNode *parent;
+    RBNode *left;
+    RBNode *right;
+    bool red;
+};
+
+// 侵入式红黑树，元素为T类型的对象，通过其中的RBNode成员Member链接
+// Traits::less(a, b)返回a是否应排在b之前，键值相同的元素按插入顺序排列
+// Traits::update(object)在object的子树改变后调用，用于维护子树上的附加信息，不需要时为空函数
+// 由调用者负责互斥
+template <typename T, RBNode T::*Member, typename Traits>
+class RBTree
+{
+private:
+    RBNode *rootNode;
+    int count;
+
+public:
+    static T *entry(RBNode *node)
+    {
+        return node ? (T *)((char *)node - (char *)&(((T *)0)->*Member)) : nullptr;
+    }
+
+    static RBNode *node(T *object)
+    {
+        return &(object->*Member);
+    }
+
+    void initialize()
+    {
+        rootNode = nullptr;
+        count = 0;
+    }
+
+    bool empty()
+    {
+        return rootNode == nullptr;
+    }
+
+    int size()
+    {
+        return count;
+    }
+
+    // 以下用于按附加信息自行查找
+    T *root()
+    {
+        return entry(rootNode);
+    }
+
+    static T *left(T *object)
+    {
+        return entry(node(object)->left);
+    }
+
+    static T *right(T *object)
+    {
+        return entry(node(object)->right);
+    }
+
+    static T *parent(T *object)
+    {
+        return entry(node(object)->parent);
+    }
+
+    // 返回最小的元素，树为空时返回nullptr
+    T *first()
+    {
+        RBNode *n = rootNode;
+        while (n && n->left)
+        {
+            n = n->left;
+        }
+        return entry(n);
+    }
+
+    // 返回最大的元素，树为空时返回nullptr
+    T *last()
+    {
+        RBNode *n = rootNode;
+        while (n && n->right)
+        {
+            n = n->right;
+        }
+        return entry(n);
+    }
+
+    // 返回object的后继，不存在时返回nullptr
+    static T *next(T *object)
+    {
+        RBNode *n = node(object);
+
+        if (n->right)
+        {
+            n = n->right;
+            while (n->left)
+            {
+                n = n->left;
+            }
+            return entry(n);
+        }
+
+        while (n->parent && n == n->parent->right)
+        {
+            n = n->parent;
+        }
+        return entry(n->parent);
+    }
+
+    // 返回object的前驱，不存在时返回nullptr
+    static T *previous(T *object)
+    {
+        RBNode *n = node(object);
+
+        if (n->left)
+        {
+            n = n->left;
+            while (n->right)
+            {
+                n = n->right;
+            }
+            return entry(n);
+        }
+
+        while (n->parent && n == n->parent->left)
+        {
+            n = n->parent;
+        }
+        return entry(n->parent);
+    }
+
+    void insert(T *object)
+    {
+        RBNode *n = node(object);
+        RBNode *parent = nullptr;
+        RBNode **link = &rootNode;
+
+        while (*link)
+        {
+            parent = *link;
+            link = Traits::less(object, entry(parent)) ? &parent->left : &parent->right;
+        }
+
+        n->parent = parent;
+        n->left = n->right = nullptr;
+        n->red = true;
+        *link = n;
+        ++count;
+
+        // 先更新插入路径上的附加信息，之后的旋转只需更新被旋转的结点
+        propagate(n);
+        insertFixup(n);
+    }
+
+    void erase(T *object)
+    {
+        RBNode *z = node(object);
+        RBNode *x, *xParent;
+        bool removedRed;
+
+        if (!z->left || !z->right)
+        {
+            x = z->left ? z->left : z->right;
+            xParent = z->parent;
+            removedRed = z->red;
+            transplant(z, x);
+        }
+        else
+        {
+            // 用后继y代替z
+            RBNode *y = z->right;
+            while (y->left)
+            {
+                y = y->left;
+            }
+
+            removedRed = y->red;
+            x = y->right;
+
+            if (y->parent == z)
+            {
+                xParent = y;
+            }
+            else
+            {
+                xParent = y->parent;
+                transplant(y, x);
+                y->right = z->right;
+                y->right->parent = y;
+            }
+
+            transplant(z, y);
+            y->left = z->left;
+            y->left->parent = y;
+            y->red = z->red;
+        }
+
+        --count;
+
+        if (!removedRed)
+        {
+            eraseFixup(x, xParent);
+        }
+
+        // 旋转不改变祖先结点的子树，从删除位置向上更新即可
+        propagate(xParent);
+    }
+
+    // object的附加信息改变后，更新它和祖先结点
+    void refresh(T *object)
+    {
+        propagate(node(object));
+    }
+
+private:
+    static bool isRed(RBNode *n)
+    {
+        return n && n->red;
+    }
+
+    void propagate(RBNode *n)
+    {
+        while (n)
+        {
+            Traits::update(entry(n));
+            n = n->parent;
+        }
+    }
+
+    // 用v代替u在树中的位置，v可为nullptr
+    void transplant(RBNode *u, RBNode *v)
+    {
+        if (!u->parent)
+        {
+            rootNode = v;
+        }
+        else if (u == u->parent->left)
+        {
+            u->parent->left = v;
+        }
+        else
+        {
+            u->parent->right = v;
+        }
+
+        if (v)
+        {
+            v->parent = u->parent;
+        }
+    }
+
+    void rotateLeft(RBNode *x)
+    {
+        RBNode *y = x->right;
+
+        x->right = y->left;
+        if (y->left)
+        {
+            y->left->parent = x;
+        }
+        transplant(x, y);
+        y->left = x;
+        x->parent = y;
+
+        Traits::update(entry(x));
+        Traits::update(entry(y));
+    }
+
+    void rotateRight(RBNode *x)
+    {
+        RBNode *y = x->left;
+
+        x->left = y->right;
+        if (y->right)
+        {
+            y->right->parent = x;
+        }
+        transplant(x, y);
+        y->right = x;
+        x->parent = y;
+
+        Traits::update(entry(x));
+        Traits::update(entry(y));
+    }
+
+    void insertFixup(RBNode *n)
+    {
+        RBNode *p, *g, *u;
+
+        while (isRed(n->parent))
+        {
+            p = n->parent;
+            g = p->parent;
+
+            if (p == g->left)
+            {
+                u = g->right;
+                if (isRed(u))
+                {
+                    p->red = u->red = false;
+                    g->red = true;
+                    n = g;
+                    continue;
+                }
+
+                if (n == p->right)
+                {
+                    rotateLeft(p);
+                    n = p;
+                    p = n->parent;
+                }
+                p->red = false;
+                g->red = true;
+                rotateRight(g);
+            }
+            else
+            {
+                u = g->left;
+                if (isRed(u))
+                {
+                    p->red = u->red = false;
+                    g->red = true;
+                    n = g;
+                    continue;
+                }
+
+                if (n == p->left)
+                {
+                    rotateRight(p);
+                    n = p;
+                    p = n->parent;
+                }
+                p->red = false;
+                g->red = true;
+                rotateLeft(g);
+            }
+        }
+
+        rootNode->red = false;
+    }
+
+    // x为代替被删除结点的结点(可为nullptr)，parent为其父结点
+    void eraseFixup(RBNode *x, RBNode *parent)
+    {
+        RBNode *w;
+
+        while (x != rootNode && !isRed(x))
+        {
+            if (x == parent->left)
+            {
+                w = parent->right;
+                if (w->red)
+                {
+                    w->red = false;
+                    parent->red = true;
+                    rotateLeft(parent);
+                    w = parent->right;
+                }
+
+                if (!isRed(w->left) && !isRed(w->right))
+                {
+                    w->red = true;
+                    x = parent;
+                    parent = x->parent;
+                    continue;
+                }
+
+                if (!isRed(w->right))
+                {
+                    w->left->red = false;
+                    w->red = true;
+                    rotateRight(w);
+                    w = parent->right;
+                }
+                w->red = parent->red;
+                parent->red = false;
+                w->right->red = false;
+                rotateLeft(parent);
+                x = rootNode;
+            }
+            else
+            {
+                w = parent->left;
+                if (w->red)
+                {
+                    w->red = false;
+                    parent->red = true;
+                    rotateRight(parent);
+                    w = parent->left;
+                }
+
+                if (!isRed(w->left) && !isRed(w->right))
+                {
+                    w->red = true;
+                    x = parent;
+                    parent = x->parent;
+                    continue;
+                }
+
+                if (!isRed(w->left))
+                {
+                    w->right->red = false;
+                    w->red = true;
+                    rotateLeft(w);
+                    w = parent->left;
+                }
+                w->red = parent->red;
+                parent->red = false;
+                w->left->red = false;
+                rotateRight(parent);
+                x = rootNode;
+            }
+        }
+
+        if (x)
+        {
+            x->red = false;
+        }
+    }
+};
+
+#endif
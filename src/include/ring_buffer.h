@@ -0,0 +1,91 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include "os_type.h"
+#include "asm_utils.h"
+
+// cache line大小，生产者和消费者各自修改的数据放在不同的cache line中，避免伪共享
+#define CACHE_LINE_SIZE 64
+
+// 无锁单生产者单消费者环形缓冲区
+// 生产者(如中断处理函数)只修改head，消费者(线程)只修改tail，双方都不需要加锁或关中断
+// N为容量，必须是2的幂
+template <typename T, int N>
+class SPSCRing
+{
+private:
+    alignas(CACHE_LINE_SIZE) volatile uint32 head; // 下一个写入位置
+    alignas(CACHE_LINE_SIZE) volatile uint32 tail; // 下一个读出位置
+    alignas(CACHE_LINE_SIZE) T buffer[N];
+
+public:
+    void initialize()
+    {
+        head = 0;
+        tail = 0;
+    }
+
+    // 生产者调用，缓冲区满时返回false
+    bool push(const T &item)
+    {
+        uint32 h = head;
+        if (h - tail == (uint32)N)
+        {
+            return false;
+        }
+
+        buffer[h & (N - 1)] = item;
+        // 数据写入后才发布新的head
+        asm_memory_barrier();
+        head = h + 1;
+        return true;
+    }
+
+    // 消费者调用，缓冲区空时返回false
+    bool pop(T &item)
+    {
+        uint32 t = tail;
+        if (t == head)
+        {
+            return false;
+        }
+
+        asm_memory_barrier();
+        item = buffer[t & (N - 1)];
+        asm_memory_barrier();
+        tail = t + 1;
+        return true;
+    }
+
+    // 消费者调用，一次取出至多count个元素，返回取出的个数
+    int popBatch(T *items, int count)
+    {
+        uint32 t = tail;
+        uint32 available = head - t;
+        if ((uint32)count > available)
+        {
+            count = available;
+        }
+
+        asm_memory_barrier();
+        for (int i = 0; i < count; ++i)
+        {
+            items[i] = buffer[(t + i) & (N - 1)];
+        }
+        asm_memory_barrier();
+        tail = t + count;
+        return count;
+    }
+
+    bool empty()
+    {
+        return head == tail;
+    }
+
+    int size()
+    {
+        return head - tail;
+    }
+};
+
+#endif
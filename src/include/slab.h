@@ -0,0 +1,33 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "intrusive_list.h"
+#include "os_type.h"
+
+// 小对象缓存中的一页，页首为本结构，之后依次存放对象
+struct SlabPage
+{
+    ListItem tagInCache;  // 在所属缓存的partial队列中的位置
+    void *freeObjects;    // 页内空闲对象组成的单向链表
+    int inUse;            // 已分配的对象个数
+};
+
+// 从常驻的内核页中切分出固定大小的小对象，避免小结构独占一整页
+// 内部关中断保护，可在中断处理函数中使用
+class SlabCache
+{
+private:
+    int objectSize;
+    int objectsPerPage;
+    // 还有空闲对象的页
+    IntrusiveList<SlabPage, &SlabPage::tagInCache> partial;
+
+public:
+    // objectSize不小于一个指针，对齐到4字节
+    void initialize(int objectSize);
+    // 成功返回对象地址，失败返回nullptr，对象的内容未初始化
+    void *allocate();
+    void release(void *object);
+};
+
+#endif
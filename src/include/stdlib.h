@@ -20,6 +20,14 @@ void memset(void *memory, char value, int length);
 int ceil(const int dividend, const int divisor);
 // 内存复制，将src开始的length个字节复制到dst中
 void memcpy(void *src, void *dst, uint32 length);
+// 内存复制，src和dst的区域可以重叠
+void memmove(void *src, void *dst, uint32 length);
+// 复制一个页，src和dst按页对齐，仅在内核态使用
+void copy_page(void *src, void *dst);
+// 将一个页清零，page按页对齐，仅在内核态使用
+void clear_page(void *page);
+// 根据CPUID选择copy_page和clear_page的实现，支持SSE2时使用非临时存储
+void select_page_routines();
 // 字符串复制
 void strcpy(const char *src, char *dst);
 #endif
\ No newline at end of file
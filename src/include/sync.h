@@ -3,30 +3,153 @@
 
 #include "os_type.h"
 #include "list.h"
+#include "thread.h"
+#include "wait_queue.h"
+#include "lockstat.h"
 
+// 排队自旋锁，按申请的先后顺序获得锁
 class SpinLock
 {
 private:
-    uint32 bolt;
+    volatile uint32 next;  // 下一个申请者取得的号码
+    volatile uint32 owner; // 当前持有锁的号码
+#ifdef LOCKSTAT
+    LockStat stat;
+#endif
 
 public:
     SpinLock();
     void initialize();
+    // 设置锁的名称，开启LOCKSTAT时按名称输出统计
+    void setName(const char *name);
     void lock();
     void unlock();
+    // 关中断后加锁，持有锁期间不会被时钟中断抢占，返回加锁前的中断状态
+    bool lockIrqSave();
+    // 解锁后恢复加锁前的中断状态
+    void unlockIrqRestore(bool status);
 };
 
 class Semaphore
 {
 private:
     uint32 counter;
-    List waiting;
+    WaitQueue waiting;
     SpinLock semLock;
+#ifdef LOCKSTAT
+    LockStat stat;
+#endif
 
 public:
     Semaphore();
     void initialize(uint32 counter);
-    void P();
+    // 设置信号量的名称，开启LOCKSTAT时按名称输出统计
+    void setName(const char *name);
+    // timeout 最长等待的微秒数，WAIT_FOREVER表示一直等待
+    // 获得信号量返回WAIT_OK，超时返回WAIT_TIMEOUT
+    int P(int timeout = WAIT_FOREVER);
     void V();
 };
+
+// 睡眠互斥锁，记录持有者，并通过优先级继承避免优先级反转
+class Mutex
+{
+private:
+    // 0=未加锁，1=已加锁且没有等待者，2=已加锁且可能有等待者
+    volatile uint32 state;
+    PCB *owner;
+    // 等待线程，按优先级从高到低排列
+    WaitQueue waiting;
+    SpinLock waitLock;
+
+    // 持有者被提升前的调度参数
+    bool boosted;
+    int savedPriority;
+    int savedTimeSlice;
+    enum SchedulePolicy savedPolicy;
+    int savedRtPriority;
+#ifdef LOCKSTAT
+    LockStat stat;
+#endif
+
+public:
+    Mutex();
+    void initialize();
+    // 设置锁的名称，开启LOCKSTAT时按名称输出统计
+    void setName(const char *name);
+    void lock();
+    // 尝试加锁，不阻塞，成功返回true
+    bool tryLock();
+    void unlock();
+    // 返回持有者，未加锁时返回nullptr
+    PCB *getOwner();
+
+private:
+    // 持有者继承等待者waiter的优先级
+    void boost(PCB *waiter);
+};
+
+// 条件变量，与Mutex配合使用
+class ConditionVariable
+{
+private:
+    WaitQueue waiting;
+    SpinLock guard;
+
+public:
+    ConditionVariable();
+    void initialize();
+    // 释放mutex并阻塞，被唤醒或超时后重新获得mutex
+    // timeout 最长等待的微秒数，WAIT_FOREVER表示一直等待
+    // 被唤醒返回WAIT_OK，超时返回WAIT_TIMEOUT
+    int wait(Mutex &mutex, int timeout = WAIT_FOREVER);
+    // 唤醒一个等待的线程
+    void signal();
+    // 唤醒所有等待的线程
+    void broadcast();
+};
+
+// 读写锁，允许多个读者或一个写者，有写者等待时新的读者阻塞，避免写者饥饿
+class RWLock
+{
+private:
+    int readers;        // 持有读锁的线程数
+    bool writer;        // 是否有线程持有写锁
+    int waitingWriters; // 等待写锁的线程数
+    WaitQueue readWaiting;  // 非互斥等待，一起被唤醒
+    WaitQueue writeWaiting; // 互斥等待，每次唤醒一个
+    SpinLock guard;
+
+public:
+    RWLock();
+    void initialize();
+    void readLock();
+    void readUnlock();
+    void writeLock();
+    void writeUnlock();
+
+private:
+    // 阻塞当前线程，返回时重新持有guard
+    void sleep(WaitQueue *queue, bool exclusive);
+};
+
+// 顺序锁，适用于读多写少的小块数据，读者不加锁，读到写者修改中的数据时重读
+class SeqLock
+{
+private:
+    volatile uint32 sequence; // 奇数表示写者正在修改
+    SpinLock writeLock;
+
+public:
+    SeqLock();
+    void initialize();
+    // 开始读，返回当前的序号
+    uint32 readBegin();
+    // 结束读，返回true表示读的过程中数据被修改，需要重读
+    bool readRetry(uint32 start);
+    // 开始写，关中断，返回关中断前的中断状态
+    bool writeBegin();
+    // 结束写，恢复中断状态
+    void writeEnd(bool status);
+};
 #endif
\ No newline at end of file
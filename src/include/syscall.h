@@ -31,4 +31,20 @@ void syscall_exit(int ret);
 int wait(int *retval);
 int syscall_wait(int *retval);
 
+// 第5个系统调用, futex_wait
+// *address == expected时阻塞，直到被futex_wake唤醒，返回0；否则立即返回-1
+// timeout 最长等待的微秒数，小于0时一直等待，超时返回-2
+int futex_wait(int *address, int expected, int timeout = -1);
+int syscall_futex_wait(int *address, int expected, int timeout);
+
+// 第6个系统调用, futex_wake
+// 唤醒至多count个阻塞在address上的线程，返回唤醒的线程数
+int futex_wake(int *address, int count);
+int syscall_futex_wake(int *address, int count);
+
+// 第7个系统调用, lockstat
+// 输出锁统计，需要编译时定义LOCKSTAT
+int lockstat();
+int syscall_lockstat();
+
 #endif
\ No newline at end of file
@@ -2,8 +2,13 @@
 #define THREAD_H
 
 #include "list.h"
+#include "intrusive_list.h"
+#include "heap.h"
 #include "os_constant.h"
-#include "address_pool.h"
+#include "vma.h"
+#include "os_type.h"
+#include "epoch.h"
+#include "wait_queue.h"
 
 typedef void (*ThreadFunction)(void *);
 
@@ -16,22 +21,49 @@ enum ProgramStatus
     DEAD
 };
 
+enum SchedulePolicy
+{
+    SCHED_NORMAL, // 普通线程，按时间片轮转
+    SCHED_FIFO,   // 实时线程，同优先级先来先服务，不受时间片限制
+    SCHED_RR      // 实时线程，同优先级按时间片轮转
+};
+
 struct PCB
 {
     int *stack;                      // 栈指针，用于调度时保存esp
     char name[MAX_PROGRAM_NAME + 1]; // 线程名
     enum ProgramStatus status;       // 线程的状态
     int priority;                    // 线程优先级
+    enum SchedulePolicy policy;      // 调度策略
+    int rtPriority;                  // 实时优先级，越大越优先，仅实时线程有效
+    uint64 wakeupTime;               // 被唤醒的时刻，ns，用于测量唤醒延迟
+    int futexKey;                    // 阻塞在其上的futex的物理地址
+    WaitQueue *waitQueue;            // 阻塞所在的等待队列
+    int waitStatus;                  // 等待的结果，WaitStatus
+    bool exclusive;                  // 是否为互斥等待
+    uint64 timeout;                  // 等待的超时时刻，jiffies，0表示不超时
+    HeapNode tagInTimeoutHeap;       // 超时堆标识
     int pid;                         // 线程pid
+    int timeSlice;                   // 线程时间片长度，单位为微秒
     int ticks;                       // 线程时间片总时间
     int ticksPassedBy;               // 线程已执行时间
     ListItem tagInGeneralList;       // 线程队列标识
     ListItem tagInAllList;           // 线程队列标识
+    ListItem tagInPidHash;           // pid散列表标识
+    EpochNode tagInRetired;          // 延迟释放标识
 
     int pageDirectoryAddress; // 页目录表地址
-    AddressPool userVirtual;  // 用户程序虚拟地址池
-    int parentPid;            // 父进程pid
+    AddressSpace userVirtual; // 用户程序虚拟地址空间
+    int parentPid;            // 父进程pid，-1表示没有父进程
     int retValue;             // 返回值
+
+    ListItem tagInChildList;  // 子进程队列标识
+    IntrusiveList<PCB, &PCB::tagInChildList> children; // 未退出的子进程队列
+    IntrusiveList<PCB, &PCB::tagInChildList> zombies;  // 已退出、等待父进程回收的子进程队列
+    WaitQueue childWaiting;   // 等待子进程退出而阻塞的线程队列
 };
 
+// 通过tagInGeneralList链接的线程队列，如就绪队列
+typedef IntrusiveList<PCB, &PCB::tagInGeneralList> ProgramList;
+
 #endif
\ No newline at end of file
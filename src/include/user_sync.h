@@ -0,0 +1,33 @@
+#ifndef USER_SYNC_H
+#define USER_SYNC_H
+
+// 用户进程使用的互斥锁，没有竞争时不陷入内核，有竞争时通过futex阻塞
+class UserMutex
+{
+private:
+    // 0=未加锁，1=已加锁且没有等待者，2=已加锁且可能有等待者
+    volatile int state;
+
+public:
+    UserMutex();
+    void initialize();
+    void lock();
+    void unlock();
+};
+
+// 用户进程使用的条件变量，与UserMutex配合使用
+class UserConditionVariable
+{
+private:
+    volatile int sequence; // 每次signal/broadcast加1
+    volatile int waiters;  // 等待的线程数，为0时signal不陷入内核
+
+public:
+    UserConditionVariable();
+    void initialize();
+    void wait(UserMutex &mutex);
+    void signal();
+    void broadcast();
+};
+
+#endif
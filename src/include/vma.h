@@ -0,0 +1,107 @@
+#ifndef VMA_H
+#define VMA_H
+
+#include "rb_tree.h"
+#include "radix_tree.h"
+#include "epoch.h"
+#include "os_type.h"
+
+// 区域的访问权限
+enum VMAProtection
+{
+    VMA_READ = 1,
+    VMA_WRITE = 2,
+    VMA_EXEC = 4
+};
+
+// 区域的后备存储
+enum VMABacking
+{
+    VMA_ANONYMOUS // 匿名内存，缺页时分配物理页，换出时写入交换区
+};
+
+// 一段连续的、属性相同的用户虚拟地址区域
+struct VMA
+{
+    uint32 start;      // 起始地址，页对齐
+    uint32 length;     // 长度，页对齐
+    uint32 protection; // VMAProtection的组合
+    int backing;       // VMABacking
+    uint32 gap;        // 与前一个区域(或地址空间起点)之间的空闲字节数
+    uint32 largestGap; // 子树中gap的最大值，用于查找空闲区间
+    RBNode tagInTree;
+
+    uint32 end()
+    {
+        return start + length;
+    }
+};
+
+// 页在交换区中的状态
+enum PageSwapState
+{
+    PAGE_SWAPPED = 1,    // 页已换出，内容只在交换区中
+    PAGE_SWAP_CACHED = 2 // 页已换入，交换区中的副本仍然有效，未被写过时换出不需要写回
+};
+
+// 页的元数据，保存在以虚拟页号为键的基数树中，只为换出过的页创建
+struct PageMeta
+{
+    EpochNode tagInRetired;
+    int swapSlot; // 在交换区中的起始扇区(相对于交换区起点)
+    uint8 state;  // PageSwapState
+    uint8 age;    // 换出的次数，饱和于255
+    uint16 flags;
+};
+
+// 归还元数据占用的交换区并释放元数据，用于销毁基数树
+void release_page_meta(void *item);
+// 宽限期结束后释放元数据
+void reclaim_page_meta(EpochNode *node);
+
+struct VMAOrder
+{
+    static bool less(VMA *a, VMA *b)
+    {
+        return a->start < b->start;
+    }
+
+    static void update(VMA *vma);
+};
+
+typedef RBTree<VMA, &VMA::tagInTree, VMAOrder> VMATree;
+
+// 用户进程的虚拟地址空间，已分配的地址用按起始地址排序的VMA树描述
+// 相邻且属性相同的区域会合并，通常只有很少几个VMA
+// 操作由调用者关中断保护
+class AddressSpace
+{
+public:
+    int startAddress; // 地址空间的起始地址
+    VMATree vmas;
+    uint32 limit; // 地址空间的结束地址(不含)
+    RadixTree pages; // 虚拟页号到PageMeta的映射
+
+public:
+    // 地址空间为[start, limit)
+    void initialize(const int start, const uint32 limit);
+    // 分配count个连续页，成功则返回第一个页的地址，失败则返回-1
+    int allocate(const int count);
+    // 释放从address开始的amount个页
+    void release(const int address, const int amount);
+    // 返回包含address的VMA，address未分配时返回nullptr
+    VMA *find(const uint32 address);
+    // 复制from的全部VMA，原有的VMA被释放，失败返回false
+    bool copy(AddressSpace *from);
+    // 释放全部VMA和页的元数据，页占用的交换区一并归还
+    void destroy();
+
+private:
+    VMA *createVMA(uint32 start, uint32 length, uint32 protection, int backing);
+    void insert(VMA *vma);
+    void erase(VMA *vma);
+    // 重新计算vma与前一个区域之间的空隙
+    void resetGap(VMA *vma);
+};
+
+#endif
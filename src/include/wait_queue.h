@@ -0,0 +1,65 @@
+#ifndef WAIT_QUEUE_H
+#define WAIT_QUEUE_H
+
+#include "intrusive_list.h"
+#include "os_type.h"
+
+struct PCB;
+class SpinLock;
+
+// 等待的结果
+enum WaitStatus
+{
+    WAIT_OK = 0,      // 被唤醒
+    WAIT_TIMEOUT = -1 // 超时
+};
+
+// 不设超时
+const int WAIT_FOREVER = -1;
+
+// 判断线程a的优先级是否高于线程b，实时线程高于普通线程
+bool higher_priority(PCB *a, PCB *b);
+
+// 等待队列，线程按优先级从高到低排列，同优先级先来先服务
+// 互斥等待者每次只唤醒指定的个数，非互斥等待者总是一起被唤醒
+// 所有操作都要求调用者已关中断
+class WaitQueue
+{
+private:
+    // 通过PCB::tagInGeneralList链接
+    ListHead waiting;
+    // 队列中非互斥等待者的个数，为0时唤醒够count个互斥等待者即可停止遍历
+    int nonExclusive;
+
+public:
+    WaitQueue();
+    void initialize();
+
+    // 阻塞当前线程，调度前释放lock(可为nullptr)，返回时保持关中断且不持有lock
+    // deadline 超时时刻，由toDeadline得到，0表示不超时
+    // exclusive 是否为互斥等待
+    // 被唤醒返回WAIT_OK，超时返回WAIT_TIMEOUT
+    int sleep(SpinLock *lock, uint64 deadline, bool exclusive = true);
+    // sleep分成的两步，进入队列后、调度前需要释放其他锁时使用
+    // 当前线程进入队列并标记为阻塞，此后被唤醒不会丢失
+    void enqueue(uint64 deadline, bool exclusive = true);
+    // 释放lock(可为nullptr)并调度，返回值同sleep
+    int block(SpinLock *lock);
+    // 唤醒全部非互斥等待者和至多count个互斥等待者，返回唤醒的线程数
+    int wakeUp(int count);
+    // 唤醒全部等待者
+    int wakeUpAll();
+
+    // 返回优先级最高的等待者，没有等待者时返回nullptr
+    PCB *front();
+    // 返回program之后的等待者
+    PCB *next(PCB *program);
+    // 将program移出队列并取消超时，不唤醒，被唤醒后sleep返回status
+    void remove(PCB *program, int status);
+    bool empty();
+
+    // 将相对超时时间(微秒)转换为sleep使用的超时时刻，timeout<0时返回0
+    static uint64 toDeadline(int timeout);
+};
+
+#endif
@@ -6,6 +6,8 @@ extern "C" void open_page_mechanism()
     int *directory = (int *)PAGE_DIRECTORY;
     //线性地址0~4MB对应的页表
     int *page = (int *)(PAGE_DIRECTORY + PAGE_SIZE);
+    // 线性地址3GB~3GB+4MB对应的页表，与低端的恒等映射分开，只有内核页标记为全局页
+    int *kernelPage = (int *)(PAGE_DIRECTORY + 2 * PAGE_SIZE);
 
     
     int entryNum = PAGE_SIZE / sizeof(int);
@@ -14,6 +16,7 @@ extern "C" void open_page_mechanism()
         directory[i] = 0;
         // 初始化线性地址0~4MB对应的页表
         page[i] = 0;
+        kernelPage[i] = 0;
     }
 
     int address = 0;
@@ -22,6 +25,8 @@ extern "C" void open_page_mechanism()
     {
         // U/S = 1, R/W = 1, P = 1
         page[i] = address | 0x7;
+        // G = 1, U/S = 1, R/W = 1, P = 1
+        kernelPage[i] = address | 0x107;
         address += PAGE_SIZE;
     }
 
@@ -30,7 +35,7 @@ extern "C" void open_page_mechanism()
     // 0~1MB
     directory[0] = ((int)page) | 0x07;
     // 3GB的内核空间
-    directory[768] = directory[0];
+    directory[768] = ((int)kernelPage) | 0x07;
     // 最后一个页目录项指向页目录表
     directory[1023] = ((int)directory) | 0x7;
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "clock.h"
+#include "os_constant.h"
+#include "asm_utils.h"
+#include "os_modules.h"
+
+// 校准时长，10ms
+const uint32 CALIBRATE_MS = 10;
+
+SystemClock::SystemClock()
+{
+}
+
+void SystemClock::initialize(uint32 frequency)
+{
+    if (frequency < MIN_TIMER_FREQUENCY)
+    {
+        frequency = MIN_TIMER_FREQUENCY;
+    }
+    else if (frequency > MAX_TIMER_FREQUENCY)
+    {
+        frequency = MAX_TIMER_FREQUENCY;
+    }
+
+    this->frequency = frequency;
+    jiffies = 0;
+    timeLock.initialize();
+
+    uint32 cycles = calibrateTSC();
+    if (!cycles)
+    {
+        cycles = 1;
+    }
+    tscKHz = cycles / CALIBRATE_MS;
+
+    // mult = (CALIBRATE_MS * 10^6 << shift) / cycles
+    shift = 24;
+    mult = (uint32)asm_udiv64((uint64)(CALIBRATE_MS * 1000000) << shift, cycles);
+
+    interruptManager.setTimerFrequency(frequency);
+
+    tscBase = asm_read_tsc();
+    nsBase = 0;
+}
+
+void SystemClock::tick()
+{
+    bool status = timeLock.writeBegin();
+
+    uint64 now = asm_read_tsc();
+    ++jiffies;
+    nsBase += cyclesToNs(now - tscBase);
+    tscBase = now;
+
+    timeLock.writeEnd(status);
+}
+
+uint64 SystemClock::monotonicNs()
+{
+    uint32 start;
+    uint64 base, ns;
+
+    // 读者不关中断，读的过程中发生时钟中断则重读
+    do
+    {
+        start = timeLock.readBegin();
+        base = tscBase;
+        ns = nsBase;
+    } while (timeLock.readRetry(start));
+
+    return ns + cyclesToNs(asm_read_tsc() - base);
+}
+
+uint64 SystemClock::getJiffies()
+{
+    uint32 start;
+    uint64 ticks;
+
+    do
+    {
+        start = timeLock.readBegin();
+        ticks = jiffies;
+    } while (timeLock.readRetry(start));
+
+    return ticks;
+}
+
+uint32 SystemClock::usToTicks(uint32 us)
+{
+    uint64 ticks = asm_udiv64((uint64)us * frequency + 999999, 1000000);
+    return ticks ? (uint32)ticks : 1;
+}
+
+uint32 SystemClock::ticksToUs(uint32 ticks)
+{
+    return (uint32)asm_udiv64((uint64)ticks * 1000000, frequency);
+}
+
+uint32 SystemClock::calibrateTSC()
+{
+    uint8 value;
+    uint32 count = PIT_FREQUENCY / 1000 * CALIBRATE_MS;
+
+    // 打开通道2的门控，关闭扬声器输出
+    asm_in_port(0x61, &value);
+    value = (value & 0xfd) | 0x1;
+    asm_out_port(0x61, value);
+
+    // 通道2，先写低字节后写高字节，方式0(计数结束时OUT2置1)，二进制计数
+    asm_out_port(0x43, 0xb0);
+    asm_out_port(0x42, count & 0xff);
+    asm_out_port(0x42, (count >> 8) & 0xff);
+
+    uint64 start = asm_read_tsc();
+    do
+    {
+        asm_in_port(0x61, &value);
+    } while (!(value & 0x20));
+    uint64 end = asm_read_tsc();
+
+    return (uint32)(end - start);
+}
+
+uint64 SystemClock::cyclesToNs(uint64 cycles)
+{
+    // 分成高低32位分别相乘，避免64位乘法溢出
+    uint64 low = ((cycles & 0xffffffff) * mult) >> shift;
+    uint64 high = ((cycles >> 32) * mult) << (32 - shift);
+    return high + low;
+}
+
+uint64 monotonic_ns()
+{
+    return systemClock.monotonicNs();
+}
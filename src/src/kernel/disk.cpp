@@ -0,0 +1,561 @@
+#include "disk.h"
+#include "asm_utils.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "os_modules.h"
+#include "pci.h"
+
+// IDE主通道的端口
+const uint16 ATA_DATA = 0x1f0;
+const uint16 ATA_ERROR = 0x1f1;
+const uint16 ATA_SECTOR_COUNT = 0x1f2;
+const uint16 ATA_LBA_LOW = 0x1f3;
+const uint16 ATA_LBA_MID = 0x1f4;
+const uint16 ATA_LBA_HIGH = 0x1f5;
+const uint16 ATA_DRIVE = 0x1f6;
+const uint16 ATA_COMMAND = 0x1f7; // 读出为状态寄存器，同时清除硬盘的中断请求
+const uint16 ATA_CONTROL = 0x3f6; // 读出为备用状态寄存器，不影响中断请求
+
+// 状态寄存器
+const uint8 ATA_BSY = 0x80;
+const uint8 ATA_DF = 0x20;
+const uint8 ATA_DRQ = 0x08;
+const uint8 ATA_ERR = 0x01;
+
+// 设备控制寄存器
+const uint8 ATA_NIEN = 0x02; // 禁止硬盘产生中断
+const uint8 ATA_SRST = 0x04; // 软件复位
+
+const uint8 ATA_CMD_READ = 0x20;
+const uint8 ATA_CMD_WRITE = 0x30;
+const uint8 ATA_CMD_READ_DMA = 0xc8;
+const uint8 ATA_CMD_WRITE_DMA = 0xca;
+
+// 主通道总线主控寄存器相对基址的偏移
+const uint16 BM_COMMAND = 0x0;
+const uint16 BM_STATUS = 0x2;
+const uint16 BM_PRD_TABLE = 0x4;
+
+// 总线主控命令寄存器
+const uint8 BM_START = 0x01;
+const uint8 BM_READ = 0x08; // 从硬盘读出，写入内存
+
+// 总线主控状态寄存器，中断和错误位写1清除
+const uint8 BM_ERROR = 0x02;
+const uint8 BM_INTERRUPT = 0x04;
+
+const uint16 PRD_END = 0x8000;
+
+const uint32 IRQ_DISK = 14;
+
+IntrusiveList<DiskRequest, &DiskRequest::tagInQueue> Disk::queue;
+DiskRequest *Disk::current;
+int Disk::window;
+byte Disk::sectorBuffer[SECTOR_SIZE];
+int Disk::busMaster;
+int Disk::prdTableAddress;
+
+// 同一时刻只有一个请求在传输，共用一个PRD表
+// 按不小于表大小的2的幂对齐，不会跨越64KB边界
+alignas(256) static DiskPRD prdTable[DISK_MAX_SEGMENTS];
+static_assert(sizeof(prdTable) <= 256, "PRD table must not cross a 64KB boundary");
+
+extern "C" void c_disk_interrupt_handler()
+{
+    Disk::service();
+}
+
+void Disk::initialize()
+{
+    queue.initialize();
+    current = nullptr;
+    window = KERNEL_VIRTUAL_START + memoryManager.kernelVirtual.resources.allocate(1) * PAGE_SIZE;
+
+    initializeDMA();
+
+    interruptManager.setIRQHandler(IRQ_DISK, (void *)asm_disk_interrupt_handler);
+    interruptManager.enableIRQ(IRQ_DISK);
+}
+
+void Disk::initializeDMA()
+{
+    PCIAddress address;
+
+    busMaster = 0;
+    prdTableAddress = memoryManager.vaddr2paddr((int)prdTable);
+
+    // 大容量存储控制器(0x01)中的IDE控制器(0x01)
+    if (!pci_find_class(0x01, 0x01, &address))
+    {
+        return;
+    }
+
+    // 编程接口的第7位表示支持总线主控，第0位表示主通道工作在PCI本地模式，此时端口不在0x1F0
+    uint32 progIF = (pci_config_read(&address, PCI_CLASS) >> 8) & 0xff;
+    if (!(progIF & 0x80) || (progIF & 0x01))
+    {
+        return;
+    }
+
+    // BAR4为总线主控寄存器所在的I/O空间，前8个端口属于主通道
+    uint32 bar = pci_config_read(&address, PCI_BAR4);
+    if (!(bar & 0x1))
+    {
+        return;
+    }
+
+    uint32 command = pci_config_read(&address, PCI_COMMAND);
+    pci_config_write(&address, PCI_COMMAND, command | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+
+    busMaster = bar & 0xfffc;
+    printf("disk: bus master DMA at 0x%x\n", busMaster);
+}
+
+bool Disk::write(int start, void *buf)
+{
+    return transfer(start, 1, buf, true);
+}
+
+bool Disk::read(int start, void *buf)
+{
+    return transfer(start, 1, buf, false);
+}
+
+bool Disk::write(int start, int count, void *buf)
+{
+    return transfer(start, count, buf, true);
+}
+
+bool Disk::read(int start, int count, void *buf)
+{
+    return transfer(start, count, buf, false);
+}
+
+bool Disk::writePhysical(int start, int count, int paddr)
+{
+    return transferPhysical(start, count, paddr, true);
+}
+
+bool Disk::readPhysical(int start, int count, int paddr)
+{
+    return transferPhysical(start, count, paddr, false);
+}
+
+bool Disk::transfer(int start, int count, void *buf, bool write)
+{
+    DiskRequest request;
+    int vaddr = (int)buf;
+    bool success = true;
+
+    while (count > 0 && success)
+    {
+        int amount = count < DISK_MAX_SECTORS ? count : DISK_MAX_SECTORS;
+        int length = amount * SECTOR_SIZE;
+
+        // 在提交者的地址空间中逐页换入并固定，转换为物理地址，等待期间这些页不会被换出或重新分配
+        request.segmentCount = 0;
+        while (length > 0)
+        {
+            int piece = PAGE_SIZE - (vaddr & 0xfff);
+            if (piece > length)
+            {
+                piece = length;
+            }
+
+            int paddr = memoryManager.pinPage(vaddr);
+            if (!paddr)
+            {
+                success = false;
+                break;
+            }
+            addSegment(&request, paddr + (vaddr & 0xfff), piece);
+            vaddr += piece;
+            length -= piece;
+        }
+
+        if (success)
+        {
+            success = submit(&request, start, amount, write);
+        }
+
+        // 每段都在一个物理页内
+        for (int i = 0; i < request.segmentCount; ++i)
+        {
+            memoryManager.unpinPage(request.segments[i].paddr & 0xfffff000);
+        }
+
+        start += amount;
+        count -= amount;
+    }
+
+    return success;
+}
+
+bool Disk::transferPhysical(int start, int count, int paddr, bool write)
+{
+    DiskRequest request;
+
+    while (count > 0)
+    {
+        int amount = count < DISK_MAX_SECTORS ? count : DISK_MAX_SECTORS;
+
+        request.segmentCount = 0;
+        addSegment(&request, paddr, amount * SECTOR_SIZE);
+
+        if (!submit(&request, start, amount, write))
+        {
+            return false;
+        }
+        start += amount;
+        count -= amount;
+        paddr += amount * SECTOR_SIZE;
+    }
+
+    return true;
+}
+
+void Disk::addSegment(DiskRequest *request, int paddr, int length)
+{
+    while (length > 0)
+    {
+        int piece = PAGE_SIZE - (paddr & 0xfff);
+        if (piece > length)
+        {
+            piece = length;
+        }
+
+        DiskSegment *segment = &(request->segments[request->segmentCount++]);
+        segment->paddr = paddr;
+        segment->length = piece;
+
+        paddr += piece;
+        length -= piece;
+    }
+}
+
+bool Disk::submit(DiskRequest *request, int start, int count, bool write)
+{
+    bool interrupt = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    PCB *cur = programManager.running;
+
+    request->sector = start;
+    request->count = count;
+    request->write = write;
+    // 调度器运行前和空闲线程中不能睡眠
+    request->polling = !cur || cur == programManager.idle;
+    request->dma = canDMA(request);
+    request->status = DISK_PENDING;
+    request->waiter.initialize();
+
+    queue.push_back(request);
+    if (!current)
+    {
+        startNext();
+    }
+
+    if (request->polling)
+    {
+        while (request->status == DISK_PENDING)
+        {
+            delay();
+            service();
+        }
+    }
+    else
+    {
+        // 关中断直到进入等待队列，完成的中断不会在睡眠之前到来
+        uint64 deadline = WaitQueue::toDeadline(DISK_TIMEOUT_US);
+        while (request->status == DISK_PENDING)
+        {
+            if (request->waiter.sleep(nullptr, deadline) == WaitStatus::WAIT_TIMEOUT &&
+                request->status == DISK_PENDING)
+            {
+                cancel(request);
+            }
+        }
+    }
+
+    interruptManager.setInterruptStatus(interrupt);
+    return request->status == DISK_DONE;
+}
+
+void Disk::startNext()
+{
+    DiskRequest *request = queue.pop_front();
+    if (request)
+    {
+        start(request);
+    }
+}
+
+void Disk::start(DiskRequest *request)
+{
+    int lba = request->sector;
+
+    current = request;
+    request->done = 0;
+    request->segment = 0;
+    request->offset = 0;
+
+    // 轮询的请求不需要硬盘产生中断
+    asm_out_port(ATA_CONTROL, request->polling ? ATA_NIEN : 0);
+
+    if (request->dma)
+    {
+        prepareDMA(request);
+    }
+
+    // 扇区数和LBA地址，LBA地址27~24和主盘、LBA模式的标志一起写入0x1F6
+    asm_out_port(ATA_SECTOR_COUNT, request->count);
+    asm_out_port(ATA_LBA_LOW, lba & 0xff);
+    asm_out_port(ATA_LBA_MID, (lba >> 8) & 0xff);
+    asm_out_port(ATA_LBA_HIGH, (lba >> 16) & 0xff);
+    asm_out_port(ATA_DRIVE, ((lba >> 24) & 0xf) | 0xe0);
+
+    if (request->dma)
+    {
+        // 命令发出后才开始总线主控传输，整个请求完成时产生一次中断
+        asm_out_port(ATA_COMMAND, request->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+        asm_out_port(busMaster + BM_COMMAND, (request->write ? 0 : BM_READ) | BM_START);
+        return;
+    }
+
+    asm_out_port(ATA_COMMAND, request->write ? ATA_CMD_WRITE : ATA_CMD_READ);
+
+    if (request->write)
+    {
+        // 写命令发出后硬盘很快请求第一个扇区的数据，此时不产生中断
+        uint8 status;
+        do
+        {
+            delay();
+            asm_in_port(ATA_CONTROL, &status);
+        } while ((status & ATA_BSY) || !(status & (ATA_DRQ | ATA_ERR | ATA_DF)));
+
+        service();
+    }
+}
+
+void Disk::service()
+{
+    uint8 status;
+    DiskRequest *request = current;
+
+    if (request && request->dma)
+    {
+        serviceDMA();
+        return;
+    }
+
+    asm_in_port(ATA_COMMAND, &status);
+
+    // 由状态判断能否推进，迟到的中断和轮询都不会重复传输
+    if (!request || (status & ATA_BSY))
+    {
+        return;
+    }
+
+    if (status & (ATA_ERR | ATA_DF))
+    {
+        finish(DISK_ERROR);
+        return;
+    }
+
+    if (request->done < request->count)
+    {
+        if (!(status & ATA_DRQ))
+        {
+            return;
+        }
+
+        if (request->write)
+        {
+            copySector(request, true);
+            for (int i = 0; i < SECTOR_SIZE; i += 2)
+            {
+                asm_outw_port(ATA_DATA, sectorBuffer[i] | (sectorBuffer[i + 1] << 8));
+            }
+        }
+        else
+        {
+            for (int i = 0; i < SECTOR_SIZE; i += 2)
+            {
+                asm_inw_port(ATA_DATA, sectorBuffer + i);
+            }
+            copySector(request, false);
+        }
+        ++request->done;
+
+        // 写入的最后一个扇区在下一次中断时才写完
+        if (request->write || request->done < request->count)
+        {
+            return;
+        }
+    }
+
+    finish(DISK_DONE);
+}
+
+void Disk::finish(int status)
+{
+    DiskRequest *request = current;
+
+    if (status == DISK_ERROR)
+    {
+        uint8 error;
+        asm_in_port(ATA_ERROR, &error);
+        printf("disk error, sector %d, error code: %x\n", request->sector + request->done, error);
+    }
+
+    current = nullptr;
+    request->status = status;
+
+    // 先启动下一个请求，唤醒等待者的同时硬盘继续工作
+    startNext();
+
+    if (!request->polling)
+    {
+        request->waiter.wakeUp(1);
+    }
+}
+
+void Disk::cancel(DiskRequest *request)
+{
+    printf("disk timeout, sector %d\n", request->sector);
+
+    if (request != current)
+    {
+        queue.erase(request);
+        request->status = DISK_ERROR;
+        return;
+    }
+
+    // 复位后硬盘放弃正在执行的命令
+    uint8 status;
+    if (request->dma)
+    {
+        asm_out_port(busMaster + BM_COMMAND, 0);
+    }
+    asm_out_port(ATA_CONTROL, ATA_SRST | ATA_NIEN);
+    delay();
+    asm_out_port(ATA_CONTROL, 0);
+    do
+    {
+        delay();
+        asm_in_port(ATA_CONTROL, &status);
+    } while (status & ATA_BSY);
+
+    finish(DISK_ERROR);
+}
+
+bool Disk::canDMA(DiskRequest *request)
+{
+    // 轮询时硬盘不产生中断，无法得知DMA何时完成
+    if (!busMaster || request->polling)
+    {
+        return false;
+    }
+
+    // 每段的起始地址和长度都要按2字节对齐
+    for (int i = 0; i < request->segmentCount; ++i)
+    {
+        if ((request->segments[i].paddr | request->segments[i].length) & 0x1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Disk::prepareDMA(DiskRequest *request)
+{
+    uint8 status;
+
+    // 段不跨越物理页，也就不跨越64KB边界，每段对应一个描述符
+    for (int i = 0; i < request->segmentCount; ++i)
+    {
+        prdTable[i].paddr = request->segments[i].paddr;
+        prdTable[i].length = request->segments[i].length;
+        prdTable[i].flags = 0;
+    }
+    prdTable[request->segmentCount - 1].flags = PRD_END;
+
+    asm_outl_port(busMaster + BM_PRD_TABLE, prdTableAddress);
+    // 先停止并设置方向，清除上一次传输留下的中断和错误位
+    asm_out_port(busMaster + BM_COMMAND, request->write ? 0 : BM_READ);
+    asm_in_port(busMaster + BM_STATUS, &status);
+    asm_out_port(busMaster + BM_STATUS, status | BM_INTERRUPT | BM_ERROR);
+}
+
+void Disk::serviceDMA()
+{
+    uint8 dmaStatus, status;
+    DiskRequest *request = current;
+
+    // 中断位在硬盘发出中断请求时置位，没有置位说明传输还没有完成
+    asm_in_port(busMaster + BM_STATUS, &dmaStatus);
+    if (!(dmaStatus & BM_INTERRUPT))
+    {
+        asm_in_port(ATA_COMMAND, &status);
+        return;
+    }
+
+    asm_out_port(busMaster + BM_COMMAND, 0);
+    asm_in_port(ATA_COMMAND, &status);
+    asm_out_port(busMaster + BM_STATUS, dmaStatus | BM_INTERRUPT | BM_ERROR);
+
+    if ((dmaStatus & BM_ERROR) || (status & (ATA_ERR | ATA_DF)))
+    {
+        finish(DISK_ERROR);
+        return;
+    }
+
+    request->done = request->count;
+    finish(DISK_DONE);
+}
+
+void Disk::copySector(DiskRequest *request, bool toDisk)
+{
+    int copied = 0;
+
+    while (copied < SECTOR_SIZE)
+    {
+        DiskSegment *segment = &(request->segments[request->segment]);
+        int length = segment->length - request->offset;
+        if (length > SECTOR_SIZE - copied)
+        {
+            length = SECTOR_SIZE - copied;
+        }
+
+        int paddr = segment->paddr + request->offset;
+        char *data = (char *)memoryManager.mapWindow(window, paddr & 0xfffff000) + (paddr & 0xfff);
+        if (toDisk)
+        {
+            memcpy(data, sectorBuffer + copied, length);
+        }
+        else
+        {
+            memcpy(sectorBuffer + copied, data, length);
+        }
+
+        copied += length;
+        request->offset += length;
+        if (request->offset == segment->length)
+        {
+            ++request->segment;
+            request->offset = 0;
+        }
+    }
+}
+
+void Disk::delay()
+{
+    uint8 status;
+    for (int i = 0; i < 4; ++i)
+    {
+        asm_in_port(ATA_CONTROL, &status);
+    }
+}
@@ -0,0 +1,71 @@
+#include "epoch.h"
+#include "asm_utils.h"
+#include "os_modules.h"
+
+EpochManager::EpochManager()
+{
+    initialize();
+}
+
+void EpochManager::initialize()
+{
+    epoch = 0;
+    readers[0] = readers[1] = 0;
+    retired[0].initialize();
+    retired[1].initialize();
+}
+
+uint32 EpochManager::readLock()
+{
+    uint32 current, slot;
+
+    while (true)
+    {
+        current = epoch;
+        slot = current & 1;
+        asm_atomic_fetch_add(&readers[slot], 1);
+
+        // 登记前纪元已推进，登记的槽位可能正在被回收，撤销后重试
+        if (epoch == current)
+        {
+            return slot;
+        }
+        asm_atomic_fetch_add(&readers[slot], (uint32)-1);
+    }
+}
+
+void EpochManager::readUnlock(uint32 slot)
+{
+    asm_atomic_fetch_add(&readers[slot], (uint32)-1);
+}
+
+void EpochManager::retire(EpochNode *node, EpochCallback callback)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    node->callback = callback;
+    retired[epoch & 1].push_front(node);
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void EpochManager::poll()
+{
+    // 上一纪元与下一纪元共用一个槽位
+    uint32 slot = (epoch + 1) & 1;
+
+    if (readers[slot])
+    {
+        return;
+    }
+
+    // 上一纪元摘下的对象已没有读者能访问到
+    EpochNode *node;
+    while ((node = retired[slot].pop_front()))
+    {
+        node->callback(node);
+    }
+
+    ++epoch;
+}
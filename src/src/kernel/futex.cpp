@@ -0,0 +1,106 @@
+#include "futex.h"
+#include "os_modules.h"
+#include "program.h"
+
+FutexManager::FutexManager()
+{
+    initialize();
+}
+
+void FutexManager::initialize()
+{
+    for (int i = 0; i < FUTEX_HASH_SIZE; ++i)
+    {
+        buckets[i].initialize();
+    }
+    futexLock.initialize();
+    futexLock.setName("futex");
+}
+
+int FutexManager::wait(int *address, int expected, int timeout)
+{
+    if (!validAddress(address))
+    {
+        return -1;
+    }
+
+    // 换入并固定futex所在的页，等待期间该页不会被换出到别的页框，唤醒者得到相同的键
+    int paddr = memoryManager.pinPage((int)address);
+    if (!paddr)
+    {
+        return -1;
+    }
+
+    PCB *cur = programManager.running;
+    bool status = futexLock.lockIrqSave();
+    int result = -1;
+
+    // 持有锁期间检查，与futex_wake之间不会丢失唤醒
+    if (*(volatile int *)address == expected)
+    {
+        cur->futexKey = paddr + ((int)address & 0xfff);
+        WaitQueue *bucket = &buckets[(cur->futexKey >> 2) % FUTEX_HASH_SIZE];
+        result = bucket->sleep(&futexLock, WaitQueue::toDeadline(timeout)) == WaitStatus::WAIT_TIMEOUT ? -2 : 0;
+    }
+    else
+    {
+        futexLock.unlock();
+    }
+    interruptManager.setInterruptStatus(status);
+
+    memoryManager.unpinPage(paddr);
+    return result;
+}
+
+int FutexManager::wake(int *address, int count)
+{
+    ProgramList wakeList;
+    wakeList.initialize();
+
+    if (!validAddress(address))
+    {
+        return 0;
+    }
+
+    // 确保页在内存中，才能得到物理地址
+    int paddr = memoryManager.pinPage((int)address);
+    if (!paddr)
+    {
+        return 0;
+    }
+
+    bool status = futexLock.lockIrqSave();
+
+    int key = paddr + ((int)address & 0xfff);
+    WaitQueue *bucket = &buckets[(key >> 2) % FUTEX_HASH_SIZE];
+    PCB *program = bucket->front();
+    PCB *next;
+    int woken = 0;
+
+    // 桶内按优先级排列，优先唤醒优先级高的线程
+    while (program && woken < count)
+    {
+        next = bucket->next(program);
+        if (program->futexKey == key)
+        {
+            bucket->remove(program, WaitStatus::WAIT_OK);
+            wakeList.push_back(program);
+            ++woken;
+        }
+        program = next;
+    }
+
+    futexLock.unlock();
+    programManager.MESA_WakeUpAll(&wakeList);
+    interruptManager.setInterruptStatus(status);
+
+    memoryManager.unpinPage(paddr);
+    return woken;
+}
+
+bool FutexManager::validAddress(int *address)
+{
+    // 只接受按4字节对齐的用户地址，不能通过比较读取内核内存
+    uint32 vaddr = (uint32)address;
+    return vaddr && vaddr < 0xc0000000 && !(vaddr & 0x3);
+}
@@ -84,15 +84,70 @@ void InterruptManager::setTimeInterrupt(void *handler)
     setInterruptDescriptor(IRQ0_8259A_MASTER, (uint32)handler, 0);
 }
 
+void InterruptManager::setTimerFrequency(uint32 frequency)
+{
+    uint32 divisor = PIT_FREQUENCY / frequency;
+
+    // 通道0，先写低字节后写高字节，方式3(方波发生器)，二进制计数
+    asm_out_port(0x43, 0x36);
+    asm_out_port(0x40, divisor & 0xff);
+    asm_out_port(0x40, (divisor >> 8) & 0xff);
+}
+
+void InterruptManager::enableIRQ(uint32 irq)
+{
+    uint8 value;
+    if (irq < 8)
+    {
+        asm_in_port(0x21, &value);
+        asm_out_port(0x21, value & ~(1 << irq));
+    }
+    else
+    {
+        asm_in_port(0xa1, &value);
+        asm_out_port(0xa1, value & ~(1 << (irq - 8)));
+        // 从片通过主片的IRQ2级联
+        asm_in_port(0x21, &value);
+        asm_out_port(0x21, value & 0xfb);
+    }
+}
+
+void InterruptManager::disableIRQ(uint32 irq)
+{
+    uint8 value;
+    if (irq < 8)
+    {
+        asm_in_port(0x21, &value);
+        asm_out_port(0x21, value | (1 << irq));
+    }
+    else
+    {
+        asm_in_port(0xa1, &value);
+        asm_out_port(0xa1, value | (1 << (irq - 8)));
+    }
+}
+
+void InterruptManager::setIRQHandler(uint32 irq, void *handler)
+{
+    uint32 vector = irq < 8 ? IRQ0_8259A_MASTER + irq : IRQ0_8259A_SLAVE + irq - 8;
+    setInterruptDescriptor(vector, (uint32)handler, 0);
+}
+
 // 中断处理函数
 extern "C" void c_time_interrupt_handler()
 {
     PCB *cur = programManager.running;
-    //if(cur->pageDirectoryAddress == 0)
-        memoryManager.kernelVirtual.LRU();
-    //else
-        cur->userVirtual.LRU();
-    if (cur->ticks)
+    systemClock.tick();
+    // 唤醒等待超时的线程
+    programManager.expireTimeouts();
+    // 用户页的访问位在全局置换扫描时检查，这里只更新内核页
+    memoryManager.kernelVirtual.LRU();
+    if (cur->policy == SchedulePolicy::SCHED_FIFO)
+    {
+        // FIFO实时线程不受时间片限制，直到阻塞、退出或被更高优先级抢占
+        ++cur->ticksPassedBy;
+    }
+    else if (cur->ticks)
     {
         --cur->ticks;
         ++cur->ticksPassedBy;
@@ -108,37 +163,27 @@ extern "C" void c_pageFault_handler(uint32 pageFault_Code, uint32 pageFault_Addr
 {
     pageFault_Addr = pageFault_Addr & 0xfffff000;
     printf("[Page Fault] Catch the fault page 0x%x\n", pageFault_Addr);
-    bool inKer_Flag = ((OSMod & 3) == 0);//in kernel or in user
-    bool inDis_Flag = ((*(int*)memoryManager.toPTE(pageFault_Addr)) & 2 ) == 2;
-    enum AddressPoolType type = OSMod == 1 ? AddressPoolType::KERNEL : AddressPoolType:: USER;
-    if(inDis_Flag)
+    // 按缺页地址而非特权级确定页所属的地址空间，系统调用中访问用户页也能正确换入
+    // 新分配的页框也按地址计入用途，内核态访问用户页得到的页框进入全局置换队列
+    bool inKer_Flag = pageFault_Addr >= 0xc0000000;
+    enum AddressPoolType type = inKer_Flag ? AddressPoolType::KERNEL : AddressPoolType::USER;
+    PageMeta *meta = memoryManager.lookupPageMeta(type, pageFault_Addr);
+    if(meta && meta->state == PAGE_SWAPPED)
     {
         memoryManager.swapIn(pageFault_Addr, inKer_Flag);
         return;
     }
 
-    int physicalPageAddress = memoryManager.allocatePhysicalPages(type, 1);
-    // int physicalPageAddress = allocatePhysicalPages(AddressPoolType::USER, 1);
+    // 按需分配的页取自预清零队列，不在缺页处理中清零
+    int physicalPageAddress = memoryManager.allocateZeroedPage(type);
     if (physicalPageAddress == 0)
     {
         /*
         not enough physical pages
         find one page swapout
         */
-        int swapOutPage = 0;
-        if(type == 1)
-        {
-            //kernel
-            swapOutPage = memoryManager.kernelVirtual.Out();
-        }
-        else
-        {
-            //user
-            swapOutPage = programManager.running->userVirtual.Out();
-        }
-        
-        memoryManager.swapOut(swapOutPage, type);
-        physicalPageAddress = memoryManager.allocatePhysicalPages(type, 1);
+        memoryManager.reclaimPhysicalPage();
+        physicalPageAddress = memoryManager.allocateZeroedPage(type);
     }
     memoryManager.connectPhysicalVirtualPage((int)pageFault_Addr, physicalPageAddress);
     asm_update_tlb();
@@ -0,0 +1,90 @@
+#include "lockstat.h"
+#include "asm_utils.h"
+#include "stdio.h"
+#include "os_modules.h"
+
+// 已注册的锁
+LockStat *lockStatList = nullptr;
+
+void lockstat_initialize(LockStat *stat, const char *name)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    bool registered = false;
+    for (LockStat *item = lockStatList; item; item = item->next)
+    {
+        if (item == stat)
+        {
+            registered = true;
+            break;
+        }
+    }
+
+    stat->name = name;
+    stat->acquisitions = 0;
+    stat->contentions = 0;
+    stat->waitCycles = 0;
+    stat->holdCycles = 0;
+    stat->maxHoldCycles = 0;
+    stat->acquireTime = 0;
+
+    if (name && !registered)
+    {
+        stat->next = lockStatList;
+        lockStatList = stat;
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void lockstat_acquired(LockStat *stat, bool contended, uint64 waitCycles)
+{
+    ++stat->acquisitions;
+    if (contended)
+    {
+        ++stat->contentions;
+        stat->waitCycles += waitCycles;
+    }
+    stat->acquireTime = asm_read_tsc();
+}
+
+void lockstat_released(LockStat *stat)
+{
+    if (!stat->acquireTime)
+    {
+        return;
+    }
+
+    uint64 hold = asm_read_tsc() - stat->acquireTime;
+    stat->acquireTime = 0;
+
+    stat->holdCycles += hold;
+    if (hold > stat->maxHoldCycles)
+    {
+        stat->maxHoldCycles = hold;
+    }
+}
+
+void lockstat_print()
+{
+#ifdef LOCKSTAT
+    printf("lock statistics (TSC cycles, %d kHz)\n", systemClock.tscKHz);
+    for (LockStat *stat = lockStatList; stat; stat = stat->next)
+    {
+        if (!stat->name)
+        {
+            continue;
+        }
+
+        uint32 avgWait = stat->contentions ? (uint32)asm_udiv64(stat->waitCycles, stat->contentions) : 0;
+        uint32 avgHold = stat->acquisitions ? (uint32)asm_udiv64(stat->holdCycles, stat->acquisitions) : 0;
+
+        printf("%s: acquired %d, contended %d, wait avg %d, hold avg %d max %d\n",
+               stat->name, stat->acquisitions, stat->contentions,
+               avgWait, avgHold, (uint32)stat->maxHoldCycles);
+    }
+#else
+    printf("lockstat is disabled, rebuild with -D LOCKSTAT\n");
+#endif
+}
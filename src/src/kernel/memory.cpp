@@ -6,6 +6,7 @@
 #include "program.h"
 #include "os_modules.h"
 #include "disk.h"
+#include "vma.h"
 
 MemoryManager::MemoryManager()
 {
@@ -16,6 +17,10 @@ void MemoryManager::initialize()
 {
     this->totalMemory = 0;
     this->totalMemory = getTotalMemory();
+    // 页框数据库建立之前分配的物理页不记录描述符
+    frames = nullptr;
+    firstFrame = 0;
+    frameCount = 0;
 
     // 预留的内存
     int usedMemory = 256 * PAGE_SIZE + 0x100000;
@@ -28,93 +33,401 @@ void MemoryManager::initialize()
     int freeMemory = this->totalMemory - usedMemory;
 
     int freePages = freeMemory / PAGE_SIZE;
-    int kernelPages = freePages / 2;
-    int userPages = freePages - kernelPages;
-    
-    int kernelPhysicalStartAddress = usedMemory;
-    int userPhysicalStartAddress = usedMemory + kernelPages * PAGE_SIZE;
-
-    int kernelPhysicalBitMapStart = BITMAP_START_ADDRESS;
-    int userPhysicalBitMapStart = kernelPhysicalBitMapStart + ceil(kernelPages, 8);
-    int kernelVirtualBitMapStart = userPhysicalBitMapStart + ceil(userPages, 8);
-    int swapManagerBitMapStart = kernelVirtualBitMapStart + ceil(kernelPages, 8);
-
-    // userpages 4 pages to test
-    userPages = 4;
-    kernelPhysical.initialize(
-        (char *)kernelPhysicalBitMapStart,
-        kernelPages,
-        kernelPhysicalStartAddress);
-
-    userPhysical.initialize(
-        (char *)userPhysicalBitMapStart,
-        userPages,
-        userPhysicalStartAddress);
+    // 内核虚拟地址池不能覆盖页目录表自映射的最后4MB
+    int kernelVirtualPages = freePages;
+    if (kernelVirtualPages > (int)((0xffc00000 - KERNEL_VIRTUAL_START) / PAGE_SIZE))
+    {
+        kernelVirtualPages = (0xffc00000 - KERNEL_VIRTUAL_START) / PAGE_SIZE;
+    }
+
+    int physicalStartAddress = usedMemory;
+
+    int physicalBitMapStart = BITMAP_START_ADDRESS;
+    int kernelVirtualBitMapStart = physicalBitMapStart + ceil(freePages, 8);
+    int swapManagerBitMapStart = kernelVirtualBitMapStart + ceil(kernelVirtualPages, 8);
+
+    // 内核和用户共用全部空闲物理页，软配额各占一半，某一方用完配额后仍可使用另一方空闲的页
+    physicalPages.initialize((char *)physicalBitMapStart, freePages);
+    this->physicalStartAddress = physicalStartAddress;
+    usedPages[AddressPoolType::KERNEL] = 0;
+    usedPages[AddressPoolType::USER] = 0;
+    pageQuota[AddressPoolType::KERNEL] = freePages / 2;
+    pageQuota[AddressPoolType::USER] = freePages - freePages / 2;
 
     kernelVirtual.initialize(
         (char *)kernelVirtualBitMapStart,
-        kernelPages,
+        kernelVirtualPages,
         KERNEL_VIRTUAL_START);
 
     swapResources.initialize((char *)swapManagerBitMapStart, 400);
     beginSector = 200;
 
+    vmaCache.initialize(sizeof(VMA));
+    radixNodeCache.initialize(sizeof(RadixNode));
+    pageMetaCache.initialize(sizeof(PageMeta));
+    kernelPageMeta.initialize();
+
+    // CPUID.01H:EDX[13]，CPU支持全局页时开启CR4.PGE
+    uint32 cpuid[4];
+    asm_cpuid(1, cpuid);
+    globalPages = (cpuid[3] & (1 << 13)) != 0;
+    if (globalPages)
+    {
+        asm_enable_global_pages();
+    }
+
+    // 预先为整个内核虚拟地址池建立页表，之后创建的进程复制的内核页目录项
+    // 不会再发生变化，内核地址空间(如按需分配的PCB)在所有进程中保持一致
+    uint32 kernelVirtualEnd = KERNEL_VIRTUAL_START + (uint32)kernelVirtualPages * PAGE_SIZE;
+    for (uint32 vaddr = KERNEL_VIRTUAL_START & 0xffc00000; vaddr < kernelVirtualEnd; vaddr += 0x400000)
+    {
+        int *pde = (int *)toPDE(vaddr);
+        if (*pde & 0x1)
+        {
+            continue;
+        }
+
+        int page = allocatePhysicalPages(AddressPoolType::KERNEL, 1);
+        if (!page)
+        {
+            break;
+        }
+        *pde = page | 0x7;
+        clear_page((void *)toPTE(vaddr));
+    }
+
+    // 页框数据库直接操作位图分配，不受换出影响
+    firstFrame = physicalStartAddress / PAGE_SIZE;
+    frameCount = freePages;
+    int framePages = ceil(frameCount * sizeof(Page), PAGE_SIZE);
+    int frameVirtual = kernelVirtual.resources.allocate(framePages);
+    int framePhysical = physicalPages.allocate(framePages);
+    if (frameVirtual == -1 || framePhysical == -1)
+    {
+        printf("can not allocate page frame database, halt.\n");
+        asm_halt();
+    }
+    usedPages[AddressPoolType::KERNEL] += framePages;
+
+    frames = (Page *)(KERNEL_VIRTUAL_START + frameVirtual * PAGE_SIZE);
+    for (int i = 0; i < framePages; ++i)
+    {
+        int *pte = (int *)toPTE((int)frames + i * PAGE_SIZE);
+        *pte = (physicalStartAddress + (framePhysical + i) * PAGE_SIZE) | 0x107;
+    }
+    memset(frames, 0, framePages * PAGE_SIZE);
+    activePages.initialize();
+    inactivePages.initialize();
+
+    // 此前分配的内核页(预建的页表和页框数据库)标记为保留
+    for (uint32 i = 0; i < frameCount; ++i)
+    {
+        if (physicalPages.get(i))
+        {
+            frames[i].refcount = 1;
+            frames[i].flags = PG_KERNEL | PG_RESERVED;
+        }
+    }
+
+    pageTableWindow = KERNEL_VIRTUAL_START + kernelVirtual.resources.allocate(1) * PAGE_SIZE;
+    frameWindow = KERNEL_VIRTUAL_START + kernelVirtual.resources.allocate(1) * PAGE_SIZE;
+    zeroWindow = KERNEL_VIRTUAL_START + kernelVirtual.resources.allocate(1) * PAGE_SIZE;
+    zeroedPages.initialize();
+
     printf("total memory: %d bytes ( %d MB )\n",
            this->totalMemory,
            this->totalMemory / 1024 / 1024);
 
-    printf("kernel pool\n"
+    printf("physical pool\n"
            "    start address: 0x%x\n"
            "    total pages: %d ( %d MB )\n"
+           "    kernel quota: %d pages, user quota: %d pages\n"
            "    bitmap start address: 0x%x\n",
-           kernelPhysicalStartAddress,
-           kernelPages, kernelPages * PAGE_SIZE / 1024 / 1024,
-           kernelPhysicalBitMapStart);
-
-    printf("user pool\n"
-           "    start address: 0x%x\n"
-           "    total pages: %d ( %d MB )\n"
-           "    bit map start address: 0x%x\n",
-           userPhysicalStartAddress,
-           userPages, userPages * PAGE_SIZE / 1024 / 1024,
-           userPhysicalBitMapStart);
+           physicalStartAddress,
+           freePages, freePages * PAGE_SIZE / 1024 / 1024,
+           pageQuota[AddressPoolType::KERNEL], pageQuota[AddressPoolType::USER],
+           physicalBitMapStart);
 
     printf("kernel virtual pool\n"
            "    start address: 0x%x\n"
            "    total pages: %d  ( %d MB ) \n"
            "    bit map start address: 0x%x\n",
            KERNEL_VIRTUAL_START,
-           kernelPages, kernelPages * PAGE_SIZE / 1024 / 1024,
+           kernelVirtualPages, kernelVirtualPages * PAGE_SIZE / 1024 / 1024,
            kernelVirtualBitMapStart);
 }
 
+// 初始化刚分配出去的页框的描述符
+static void initialize_frame(Page *page, enum AddressPoolType type)
+{
+    page->refcount = 1;
+    page->mapcount = 0;
+    page->flags = type == AddressPoolType::KERNEL ? PG_KERNEL : PG_USER;
+    page->owner = nullptr;
+    page->vpn = 0;
+}
+
 int MemoryManager::allocatePhysicalPages(enum AddressPoolType type, const int count)
 {
-    int start = -1;
+    int index = physicalPages.allocate(count);
+    if (index == -1)
+    {
+        // 位图中已没有空闲页，预清零的页也可以直接使用
+        Page *page = count == 1 ? zeroedPages.pop_front() : nullptr;
+        if (!page)
+        {
+            return 0;
+        }
+        initialize_frame(page, type);
+        ++usedPages[type];
+        return pageToPaddr(page);
+    }
 
-    if (type == AddressPoolType::KERNEL)
+    int start = physicalStartAddress + index * PAGE_SIZE;
+    usedPages[type] += count;
+
+    for (int i = 0; i < count; ++i)
     {
-        start = kernelPhysical.allocate(count);
+        Page *page = paddrToPage(start + i * PAGE_SIZE);
+        if (page)
+        {
+            initialize_frame(page, type);
+        }
     }
-    else if (type == AddressPoolType::USER)
+
+    return start;
+}
+
+int MemoryManager::allocateZeroedPage(enum AddressPoolType type)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    int paddr;
+    Page *page = zeroedPages.pop_front();
+    if (page)
     {
-        start = userPhysical.allocate(count);
+        initialize_frame(page, type);
+        ++usedPages[type];
+        paddr = pageToPaddr(page);
+    }
+    else
+    {
+        // 预清零的页已用完，在前台清零
+        paddr = allocatePhysicalPages(type, 1);
+        if (paddr)
+        {
+            clear_page(mapWindow(frameWindow, paddr));
+        }
     }
 
-    return (start == -1) ? 0 : start;
+    interruptManager.setInterruptStatus(status);
+    return paddr;
+}
+
+bool MemoryManager::refillZeroedPage()
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    int index = -1;
+    if (zeroedPages.size() < ZEROED_POOL_SIZE)
+    {
+        index = physicalPages.allocate(1);
+    }
+    interruptManager.setInterruptStatus(status);
+
+    if (index == -1)
+    {
+        return false;
+    }
+
+    // 清零时不关中断，页已从位图中分配，不会被其他线程使用
+    int paddr = physicalStartAddress + index * PAGE_SIZE;
+    clear_page(mapWindow(zeroWindow, paddr));
+
+    interruptManager.disableInterrupt();
+    Page *page = paddrToPage(paddr);
+    page->refcount = 0;
+    page->flags = PG_ZERO;
+    zeroedPages.push_back(page);
+    interruptManager.setInterruptStatus(status);
+
+    return true;
 }
 
 void MemoryManager::releasePhysicalPages(enum AddressPoolType type, const int paddr, const int count)
 {
-    if (type == AddressPoolType::KERNEL)
+    for (int i = 0; i < count; ++i)
     {
-        kernelPhysical.release(paddr, count);
+        int address = paddr + i * PAGE_SIZE;
+        int index = (address - physicalStartAddress) / PAGE_SIZE;
+        Page *page = paddrToPage(address);
+
+        if (address < physicalStartAddress || index >= physicalPages.length)
+        {
+            continue;
+        }
+
+        // 页框数据库建立之前分配的页
+        if (!page)
+        {
+            physicalPages.release(index, 1);
+            --usedPages[type];
+            continue;
+        }
+
+        // 已经空闲，或者还有其他引用
+        if (page->refcount == 0)
+        {
+            continue;
+        }
+        if (--page->refcount)
+        {
+            if (page->mapcount)
+            {
+                --page->mapcount;
+            }
+            continue;
+        }
+
+        if (page->flags & PG_LRU)
+        {
+            unlinkPage(page);
+        }
+        page->mapcount = 0;
+        page->owner = nullptr;
+
+        // 按分配时记录的用途统计，不依赖调用者给出的类型
+        --usedPages[(page->flags & PG_KERNEL) ? AddressPoolType::KERNEL : AddressPoolType::USER];
+        page->flags = 0;
+        physicalPages.release(index, 1);
     }
-    else if (type == AddressPoolType::USER)
+}
+
+Page *MemoryManager::paddrToPage(const int paddr)
+{
+    uint32 pfn = (uint32)paddr / PAGE_SIZE;
+    if (pfn < firstFrame || pfn - firstFrame >= frameCount)
+    {
+        return nullptr;
+    }
+    return &frames[pfn - firstFrame];
+}
+
+int MemoryManager::pageToPaddr(Page *page)
+{
+    return (firstFrame + (page - frames)) * PAGE_SIZE;
+}
+
+void MemoryManager::getPhysicalPage(const int paddr)
+{
+    Page *page = paddrToPage(paddr);
+    if (page)
+    {
+        ++page->refcount;
+    }
+}
+
+int MemoryManager::pinPage(const int vaddr)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    int *pde = (int *)toPDE(vaddr);
+    int *pte = (int *)toPTE(vaddr);
+    if (!(*pde & 0x1) || !(*pte & 0x1))
+    {
+        // 访问一次，由缺页处理换入或分配
+        *(volatile char *)vaddr;
+    }
+
+    int paddr = 0;
+    if ((*pde & 0x1) && (*pte & 0x1))
     {
+        paddr = *pte & 0xfffff000;
+        getPhysicalPage(paddr);
+    }
+
+    interruptManager.setInterruptStatus(status);
+    return paddr;
+}
+
+void MemoryManager::unpinPage(const int paddr)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
 
-        userPhysical.release(paddr, count);
+    Page *page = paddrToPage(paddr);
+    if (page)
+    {
+        if (page->mapcount == 0)
+        {
+            // 固定期间页已被释放，最后一个引用由这里归还
+            releasePhysicalPages((page->flags & PG_KERNEL) ? AddressPoolType::KERNEL : AddressPoolType::USER, paddr, 1);
+        }
+        else
+        {
+            --page->refcount;
+        }
     }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void MemoryManager::mapPhysicalPage(const int paddr, PCB *owner, const int vaddr)
+{
+    Page *page = paddrToPage(paddr);
+    if (page)
+    {
+        ++page->mapcount;
+        page->owner = owner;
+        page->vpn = (uint32)vaddr >> 12;
+
+        // 新映射的用户页加入全局置换队列
+        if (owner && (page->flags & PG_USER) && !(page->flags & (PG_LRU | PG_TABLE)))
+        {
+            page->flags |= PG_LRU | PG_ACTIVE;
+            activePages.push_back(page);
+        }
+    }
+}
+
+void MemoryManager::releaseUserPages(int *pageDir)
+{
+    for (int i = 0; i < 768; ++i)
+    {
+        if (!(pageDir[i] & 0x1))
+        {
+            continue;
+        }
+
+        int tablePaddr = pageDir[i] & 0xfffff000;
+        int *table = (int *)mapWindow(pageTableWindow, tablePaddr);
+        for (int j = 0; j < 1024; ++j)
+        {
+            if (table[j] & 0x1)
+            {
+                releasePhysicalPages(AddressPoolType::USER, table[j] & 0xfffff000, 1);
+            }
+        }
+
+        releasePhysicalPages(AddressPoolType::USER, tablePaddr, 1);
+        pageDir[i] = 0;
+    }
+}
+
+void MemoryManager::unlinkPage(Page *page)
+{
+    if (page->flags & PG_ACTIVE)
+    {
+        activePages.erase(page);
+    }
+    else
+    {
+        inactivePages.erase(page);
+    }
+    page->flags &= ~(PG_LRU | PG_ACTIVE);
 }
 
 int MemoryManager::getTotalMemory()
@@ -169,17 +482,7 @@ int MemoryManager::allocatePages(enum AddressPoolType type, const int count)
             int *pte = (int*)toPTE(vaddress);
             if (type == AddressPoolType::KERNEL)
             {
-                int index = (vaddress - kernelVirtual.startAddress) / PAGE_SIZE;
-                int i = 0;
-                for (i = 0; i < MAX_PAGES && kernelVirtual.lruindex[i] != index; i++);
-                kernelVirtual.lruindex[i] = -1;
-            }
-            else if (type == AddressPoolType::USER)
-            { 
-                int index = (vaddress - (programManager.running)->userVirtual.startAddress) / PAGE_SIZE;
-                int i = 0;
-                for (i = 0; i < MAX_PAGES && (programManager.running)->userVirtual.lruindex[i] != index; i++);
-                (programManager.running)->userVirtual.lruindex[i] = -1;
+                kernelVirtual.untrack((vaddress - kernelVirtual.startAddress) / PAGE_SIZE, 1);
             }
             printf("[%x, %x]Not enough phy-pages\n",vaddress, *pte);
         }
@@ -213,20 +516,30 @@ bool MemoryManager::connectPhysicalVirtualPage(const int virtualAddress, const i
     // 页目录项无对应的页表，先分配一个页表
     if (!(*pde & 0x00000001))
     {
-        // 从内核物理地址空间中分配一个页表
-        int page = allocatePhysicalPages(AddressPoolType::KERNEL, 1);
+        // 从内核物理地址空间中分配一个已清零的页表
+        int page = allocateZeroedPage(AddressPoolType::KERNEL);
         if (!page)
             return false;
 
         // 使页目录项指向页表
         *pde = page | 0x7;
-        // 初始化页表
-        char *pagePtr = (char *)(((int)pte) & 0xfffff000);
-        memset(pagePtr, 0, PAGE_SIZE);
+        Page *table = paddrToPage(page);
+        if (table)
+        {
+            table->flags |= PG_TABLE;
+        }
     }
 
-    // 使页表项指向物理页
-    *pte = physicalPageAddress | 0x7;
+    // 使页表项指向物理页，内核地址空间在所有进程中相同，标记为全局页
+    if ((uint32)virtualAddress >= 0xc0000000)
+    {
+        *pte = physicalPageAddress | 0x107;
+    }
+    else
+    {
+        *pte = physicalPageAddress | 0x7;
+    }
+    mapPhysicalPage(physicalPageAddress, (uint32)virtualAddress >= 0xc0000000 ? nullptr : programManager.running, virtualAddress);
     printf("Connecting VP: 0x%x with PP: 0x%x PTE%x\n",virtualAddress, physicalPageAddress, *pte);
     return true;
 }
@@ -247,20 +560,100 @@ void MemoryManager::releasePages(enum AddressPoolType type, const int virtualAdd
     int *pte;
     for (int i = 0; i < count; ++i, vaddr += PAGE_SIZE)
     {
-        // 第一步，对每一个虚拟页，释放为其分配的物理页
-        releasePhysicalPages(type, vaddr2paddr(vaddr), 1);
+        // 第一步，对每一个虚拟页，释放为其分配的物理页，已换出的页只需归还交换区
+        pte = (int *)toPTE(vaddr);
+        if (*pte & 0x1)
+        {
+            releasePhysicalPages(type, vaddr2paddr(vaddr), 1);
+        }
+        dropPageMeta(type, vaddr);
 
         // 设置页表项为不存在，防止释放后被再次使用
-        pte = (int *)toPTE(vaddr);
         *pte = 0;
         // 刷新TLB
-        asm_update_tlb();
+        if (type == AddressPoolType::KERNEL)
+        {
+            flushKernelPage(vaddr);
+        }
+        else
+        {
+            asm_update_tlb();
+        }
     }
 
     // 第二步，释放虚拟页
     releaseVirtualPages(type, virtualAddress, count);
 }
 
+int MemoryManager::allocatePinnedPages(const int count, bool zeroed)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    // 直接从位图分配虚拟页，与页框数据库一样不进入kernelVirtual的LRU记录
+    int index = kernelVirtual.resources.allocate(count);
+    if (index == -1)
+    {
+        interruptManager.setInterruptStatus(status);
+        return 0;
+    }
+
+    int virtualAddress = kernelVirtual.startAddress + index * PAGE_SIZE;
+    for (int i = 0; i < count; ++i)
+    {
+        int vaddr = virtualAddress + i * PAGE_SIZE;
+        int paddr = zeroed ? allocateZeroedPage(AddressPoolType::KERNEL)
+                           : allocatePhysicalPages(AddressPoolType::KERNEL, 1);
+        if (!paddr || !connectPhysicalVirtualPage(vaddr, paddr))
+        {
+            if (paddr)
+            {
+                releasePhysicalPages(AddressPoolType::KERNEL, paddr, 1);
+            }
+            releasePinnedPages(virtualAddress, i);
+            kernelVirtual.resources.release(index + i, count - i);
+            interruptManager.setInterruptStatus(status);
+            return 0;
+        }
+    }
+
+    interruptManager.setInterruptStatus(status);
+    return virtualAddress;
+}
+
+void MemoryManager::releasePinnedPages(const int virtualAddress, const int count)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    for (int i = 0; i < count; ++i)
+    {
+        int vaddr = virtualAddress + i * PAGE_SIZE;
+        int *pte = (int *)toPTE(vaddr);
+        if (*pte & 0x1)
+        {
+            releasePhysicalPages(AddressPoolType::KERNEL, *pte & 0xfffff000, 1);
+        }
+        *pte = 0;
+        flushKernelPage(vaddr);
+    }
+    kernelVirtual.resources.release((virtualAddress - kernelVirtual.startAddress) / PAGE_SIZE, count);
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void MemoryManager::flushKernelPage(const int virtualAddress)
+{
+    if (globalPages)
+    {
+        asm_invlpg(virtualAddress);
+    }
+    else
+    {
+        asm_update_tlb();
+    }
+}
+
 int MemoryManager::vaddr2paddr(int vaddr)
 {
     int *pte = (int *)toPTE(vaddr);
@@ -284,95 +677,376 @@ void MemoryManager::releaseVirtualPages(enum AddressPoolType type, const int vad
 int MemoryManager::swapOut(uint32 vaddr, int mod)
 {
     enum AddressPoolType type = mod == 1 ? AddressPoolType::KERNEL : AddressPoolType:: USER;
+    if (type == AddressPoolType::USER)
+    {
+        // 用户页通过页框的反向映射换出
+        Page *page = paddrToPage(vaddr2paddr(vaddr));
+        if (!page || !(page->flags & PG_LRU))
+        {
+            return -1;
+        }
+        unlinkPage(page);
+        return swapOutPage(page);
+    }
+
+    // 只换出被记录的内核页，窗口、页框数据库等未记录的页不能换出
+    if (vaddr < (uint32)kernelVirtual.startAddress ||
+        kernelVirtual.find((vaddr - kernelVirtual.startAddress) / PAGE_SIZE) == -1)
+    {
+        return -1;
+    }
+
     int *pte = (int *)toPTE(vaddr);
-    int index = swapResources.allocate(8);//one page equal eight sections
-    if (index == -1)
+    Page *frame = (*pte & 0x1) ? paddrToPage(*pte & 0xfffff000) : nullptr;
+    if (frame && frame->refcount > frame->mapcount)
     {
-        printf("Swapping Out Failed ,due to disk swap space is not enough\n");
         return -1;
     }
-    if (mod == 1){
-        printf("[Mod Kernel]Swapping out Page: 0x%x to Sector %d\n", vaddr, index + beginSector);
+
+    PageMeta *meta = prepareSwapSlot(&kernelPageMeta, vaddr);
+    if (!meta)
+    {
+        return -1;
     }
-    else{
-        printf("[Mod User]Swapping out Page: 0x%x to Sector %d\n", vaddr, index + beginSector);
+
+    // 换入后未被写过的页在交换区中的副本仍然有效，不需要写回
+    bool clean = meta->state == PAGE_SWAP_CACHED && !(*pte & 0x40);
+    int index = meta->swapSlot;
+    printf("[Mod Kernel]Swapping out Page: 0x%x to Sector %d\n", vaddr, index + beginSector);
+    if (!clean)
+    {
+        int paddr = vaddr2paddr(vaddr);
+        int result = writeBack(paddrToPage(paddr), paddr, vaddr, index + beginSector);
+        if (result != 0)
+        {
+            return result == 1 ? 0 : -1;
+        }
     }
-    for (int i = 0; i < 8; i++)
+    meta->state = PAGE_SWAPPED;
+    if (meta->age < 255)
     {
-        char *ptr = (char *)vaddr + i * 512;
-        Disk::write(index + i + beginSector, (void *)ptr);
+        ++meta->age;
     }
     releasePhysicalPages(type, vaddr2paddr(vaddr), 1);
-    if (type == AddressPoolType::KERNEL)
+    kernelVirtual.untrack((vaddr - kernelVirtual.startAddress) / PAGE_SIZE, 1);
+    // 交换区的位置记录在元数据中，页表项置为不存在
+    *pte = 0;
+    // 刷新TLB
+    flushKernelPage(vaddr);
+    return 0;
+}
+
+int MemoryManager::swapOutPage(Page *page)
+{
+    PCB *owner = page->owner;
+    uint32 vaddr = page->vpn << 12;
+    int paddr = pageToPaddr(page);
+
+    PageMeta *meta = prepareSwapSlot(&(owner->userVirtual.pages), vaddr);
+    if (!meta)
     {
-        int index = (vaddr - kernelVirtual.startAddress) / PAGE_SIZE;
-        int i = 0;
-        for (i = 0; i < MAX_PAGES && kernelVirtual.lruindex[i] != index; i++);
-        kernelVirtual.lruindex[i] = -1;
+        page->flags |= PG_LRU | PG_ACTIVE;
+        activePages.push_back(page);
+        return -1;
     }
-    else if (type == AddressPoolType::USER)
-    { 
-        int index = (vaddr - (programManager.running)->userVirtual.startAddress) / PAGE_SIZE;
-        int i = 0;
-        for (i = 0; i < MAX_PAGES && (programManager.running)->userVirtual.lruindex[i] != index; i++);
-        printf("Realease index %d page\n",index);
-        (programManager.running)->userVirtual.lruindex[i] = -1;
-    }
-    //store pte and significance bit
-    *pte = (index << 20) + 2;
-    // 刷新TLB
-    asm_update_tlb();
+
+    int *pte = rmapPTE(page);
+    bool clean = meta->state == PAGE_SWAP_CACHED && !(*pte & 0x40);
+    int index = meta->swapSlot;
+    printf("[Mod User]Swapping out Page: 0x%x of %s to Sector %d\n", vaddr, owner->name, index + beginSector);
+
+    // 页可能属于其他进程，按物理地址写回
+    if (!clean)
+    {
+        int result = writeBack(page, paddr, vaddr, index + beginSector);
+        if (result == 1)
+        {
+            return 0;
+        }
+        if (result == -1)
+        {
+            page->flags |= PG_LRU | PG_ACTIVE;
+            activePages.push_back(page);
+            return -1;
+        }
+        // 写回期间窗口可能被重新映射
+        pte = rmapPTE(page);
+    }
+    meta->state = PAGE_SWAPPED;
+    if (meta->age < 255)
+    {
+        ++meta->age;
+    }
+
+    *pte = 0;
+    // 当前地址空间(包括被内核线程借用的)可能缓存着该表项，其他进程的表项在切换页目录表时刷新
+    flushKernelPage(vaddr);
+    releasePhysicalPages(AddressPoolType::USER, paddr, 1);
     return 0;
 }
+
+int MemoryManager::writeBack(Page *page, int paddr, uint32 vaddr, int sector)
+{
+    int *pte = page && page->owner ? rmapPTE(page) : (int *)toPTE(vaddr);
+
+    // 先清除脏位，写回期间页被再次写过时脏位重新置位
+    *pte &= ~0x40;
+    flushKernelPage(vaddr);
+
+    // 写回期间线程可能睡眠，持有引用防止页被释放后重新分配
+    getPhysicalPage(paddr);
+    bool written = Disk::writePhysical(sector, 8, paddr);
+
+    if (page && page->mapcount == 0)
+    {
+        // 页在写回期间被释放，它的元数据和交换区随之释放
+        releasePhysicalPages((page->flags & PG_KERNEL) ? AddressPoolType::KERNEL : AddressPoolType::USER, paddr, 1);
+        return 1;
+    }
+    if (page)
+    {
+        --page->refcount;
+    }
+
+    pte = page && page->owner ? rmapPTE(page) : (int *)toPTE(vaddr);
+    if (!written)
+    {
+        // 交换区中的副本已经无效，下次换出时必须重新写回
+        *pte |= 0x40;
+        return -1;
+    }
+    return (*pte & 0x40) ? -1 : 0;
+}
+
 int MemoryManager::swapIn(uint32 vaddr, int mod)
 {
     enum AddressPoolType type = mod == 1 ? AddressPoolType::KERNEL : AddressPoolType:: USER;
     int *pte = (int *)toPTE(vaddr);
-    int index = (*pte) >> 20;
+    PageMeta *meta = lookupPageMeta(type, vaddr);
+    if (!meta || meta->state != PAGE_SWAPPED)
+    {
+        return -1;
+    }
+    int index = meta->swapSlot;
     printf("[Mod %d]Swapping in Page: 0x%x from Sector %d\n",!mod, vaddr, index + beginSector);
     int physicalPageAddress = allocatePhysicalPages(type, 1);
-    // int physicalPageAddress = allocatePhysicalPages(AddressPoolType::USER, 1);
     if (physicalPageAddress == 0)
     {
-        /*
-        not enough physical pages
-        find one page swapout
-        */
-        int swapOutPage = 0;
-        if(type == 1)
+        // 物理页不足，先换出一页
+        reclaimPhysicalPage();
+        physicalPageAddress = allocatePhysicalPages(type, 1);
+        if (physicalPageAddress == 0)
         {
-            // kernel
-            swapOutPage = memoryManager.kernelVirtual.Out();
+            return -1;
         }
-        else
+    }
+    // 读入完成后才建立映射，等待硬盘期间其他线程不会看到未读完的页
+    if (!Disk::readPhysical(index + beginSector, 8, physicalPageAddress))
+    {
+        releasePhysicalPages(type, physicalPageAddress, 1);
+        return -1;
+    }
+    // 等待期间其他线程已经换入了该页
+    if ((*(int *)toPDE(vaddr) & 0x1) && (*pte & 0x1))
+    {
+        releasePhysicalPages(type, physicalPageAddress, 1);
+        return 0;
+    }
+    connectPhysicalVirtualPage((int)vaddr, physicalPageAddress);
+    // 保留交换区中的副本
+    meta->state = PAGE_SWAP_CACHED;
+    if (type == AddressPoolType::KERNEL)
+    {
+        kernelVirtual.track((vaddr - kernelVirtual.startAddress) / PAGE_SIZE, 1);
+    }
+    // 刷新TLB
+    flushKernelPage(vaddr);
+    return 0;
+}
+
+int MemoryManager::reclaimPhysicalPage()
+{
+    // 内核页只在内核超出软配额或者没有可换出的用户页时换出
+    if (usedPages[AddressPoolType::KERNEL] <= pageQuota[AddressPoolType::KERNEL] ||
+        usedPages[AddressPoolType::USER] > pageQuota[AddressPoolType::USER])
+    {
+        Page *page = selectVictim();
+        if (page && swapOutPage(page) == 0)
         {
-            // user 
-            swapOutPage = programManager.running->userVirtual.Out();
+            return 0;
         }
-        swapOut(swapOutPage, type);
-        physicalPageAddress = allocatePhysicalPages(type, 1);
     }
-    connectPhysicalVirtualPage((int)vaddr, physicalPageAddress);
-    for (int i = 0; i < 8; i++)
+
+    int vaddr = kernelVirtual.Out();
+    if (vaddr == -1)
+    {
+        return -1;
+    }
+    return swapOut(vaddr, AddressPoolType::KERNEL);
+}
+
+Page *MemoryManager::selectVictim()
+{
+    // 关中断期间访问位不会被重新设置，每个页至多经过两次队列移动就能选出
+    int budget = 3 * (activePages.size() + inactivePages.size());
+
+    while (budget-- > 0)
+    {
+        // inactive队列短于active队列时从active的头部补充，清除访问位给它被再次访问的机会
+        if (inactivePages.empty() || inactivePages.size() < activePages.size())
+        {
+            Page *page = activePages.pop_front();
+            if (!page)
+            {
+                break;
+            }
+            testAndClearAccessed(page);
+            page->flags &= ~PG_ACTIVE;
+            inactivePages.push_back(page);
+            continue;
+        }
+
+        // 被固定的页(引用多于映射)正在进行I/O，不能换出
+        Page *page = inactivePages.pop_front();
+        if (page->refcount > page->mapcount || testAndClearAccessed(page))
+        {
+            page->flags |= PG_ACTIVE;
+            activePages.push_back(page);
+            continue;
+        }
+
+        page->flags &= ~PG_LRU;
+        return page;
+    }
+
+    return nullptr;
+}
+
+bool MemoryManager::testAndClearAccessed(Page *page)
+{
+    int *pte = rmapPTE(page);
+    if (!(*pte & 0x20))
     {
-        char *ptr = (char *)vaddr + i * 512;
-        Disk::read(index + i + beginSector, (void *)ptr);
+        return false;
     }
-    swapResources.release(index, 8);
+
+    *pte &= ~0x20;
+    // 缓存在TLB中的表项被访问时不会再设置访问位
+    flushKernelPage(page->vpn << 12);
+    return true;
+}
+
+int *MemoryManager::rmapPTE(Page *page)
+{
+    uint32 vaddr = page->vpn << 12;
+    int *pageDir = (int *)page->owner->pageDirectoryAddress;
+    int *table = (int *)mapWindow(pageTableWindow, pageDir[vaddr >> 22] & 0xfffff000);
+    return table + ((vaddr >> 12) & 0x3ff);
+}
+
+void *MemoryManager::mapWindow(int window, int paddr)
+{
+    // 窗口不设全局位，刷新后不会残留在TLB中
+    *(int *)toPTE(window) = paddr | 0x3;
+    flushKernelPage(window);
+    return (void *)window;
+}
+
+PageMeta *MemoryManager::prepareSwapSlot(RadixTree *tree, uint32 vaddr)
+{
+    PageMeta *meta = (PageMeta *)tree->lookup(vaddr >> 12);
+    if (!meta)
+    {
+        meta = (PageMeta *)pageMetaCache.allocate();
+        if (!meta)
+        {
+            printf("Swapping Out Failed ,due to page meta can not be allocated\n");
+            return nullptr;
+        }
+        meta->swapSlot = -1;
+        meta->state = 0;
+        meta->age = 0;
+        meta->flags = 0;
+        if (!tree->insert(vaddr >> 12, meta))
+        {
+            pageMetaCache.release(meta);
+            printf("Swapping Out Failed ,due to page meta can not be allocated\n");
+            return nullptr;
+        }
+    }
+
+    if (meta->swapSlot == -1)
+    {
+        meta->swapSlot = swapResources.allocate(8);//one page equal eight sections
+        if (meta->swapSlot == -1)
+        {
+            tree->remove(vaddr >> 12);
+            epochManager.retire(&(meta->tagInRetired), reclaim_page_meta);
+            printf("Swapping Out Failed ,due to disk swap space is not enough\n");
+            return nullptr;
+        }
+    }
+
+    return meta;
+}
+
+RadixTree *MemoryManager::pageMetaTree(enum AddressPoolType type)
+{
     if (type == AddressPoolType::KERNEL)
     {
-        int index = (vaddr - kernelVirtual.startAddress) / PAGE_SIZE;
-        int i = 0;
-        for (i = 0; i < MAX_PAGES && kernelVirtual.lruindex[i] != -1; i++);
-        kernelVirtual.lruindex[i] = index;
+        return &kernelPageMeta;
     }
-    else if (type == AddressPoolType::USER)
-    { 
-        int index = (vaddr - (programManager.running)->userVirtual.startAddress) / PAGE_SIZE;
-        int i = 0;
-        for (i = 0; i < MAX_PAGES && (programManager.running)->userVirtual.lruindex[i] != -1; i++);
-        (programManager.running)->userVirtual.lruindex[i] = index;
+    return &(programManager.running->userVirtual.pages);
+}
+
+PageMeta *MemoryManager::lookupPageMeta(enum AddressPoolType type, const uint32 vaddr)
+{
+    return (PageMeta *)pageMetaTree(type)->lookup(vaddr >> 12);
+}
+
+void MemoryManager::dropPageMeta(enum AddressPoolType type, const uint32 vaddr)
+{
+    PageMeta *meta = (PageMeta *)pageMetaTree(type)->remove(vaddr >> 12);
+    if (!meta)
+    {
+        return;
     }
-    // 刷新TLB
-    asm_update_tlb();
-}
\ No newline at end of file
+
+    if (meta->swapSlot != -1)
+    {
+        swapResources.release(meta->swapSlot, 8);
+    }
+    // 缺页处理可能正在读取元数据，宽限期后再释放
+    epochManager.retire(&(meta->tagInRetired), reclaim_page_meta);
+}
+
+int MemoryManager::copySwapSlot(const int index, char *buffer)
+{
+    int copied = swapResources.allocate(8);
+    if (copied == -1)
+    {
+        return -1;
+    }
+
+    if (!Disk::read(index + beginSector, 8, buffer) || !Disk::write(copied + beginSector, 8, buffer))
+    {
+        swapResources.release(copied, 8);
+        return -1;
+    }
+    return copied;
+}
+
+void reclaim_page_meta(EpochNode *node)
+{
+    memoryManager.pageMetaCache.release((PageMeta *)((int)node - (int)&((PageMeta *)0)->tagInRetired));
+}
+
+void release_page_meta(void *item)
+{
+    PageMeta *meta = (PageMeta *)item;
+    if (meta->swapSlot != -1)
+    {
+        memoryManager.swapResources.release(meta->swapSlot, 8);
+    }
+    memoryManager.pageMetaCache.release(meta);
+}
@@ -0,0 +1,64 @@
+#include "pci.h"
+#include "asm_utils.h"
+
+const uint16 PCI_CONFIG_ADDRESS = 0xcf8;
+const uint16 PCI_CONFIG_DATA = 0xcfc;
+
+uint32 pci_config_read(PCIAddress *address, uint8 offset)
+{
+    uint32 value;
+
+    // 第31位为使能位，总线号、设备号、功能号和寄存器偏移依次排列
+    asm_outl_port(PCI_CONFIG_ADDRESS, 0x80000000 | (address->bus << 16) | (address->device << 11) |
+                                          (address->function << 8) | (offset & 0xfc));
+    asm_inl_port(PCI_CONFIG_DATA, &value);
+    return value;
+}
+
+void pci_config_write(PCIAddress *address, uint8 offset, uint32 value)
+{
+    asm_outl_port(PCI_CONFIG_ADDRESS, 0x80000000 | (address->bus << 16) | (address->device << 11) |
+                                          (address->function << 8) | (offset & 0xfc));
+    asm_outl_port(PCI_CONFIG_DATA, value);
+}
+
+bool pci_find_class(uint8 classCode, uint8 subclass, PCIAddress *address)
+{
+    PCIAddress candidate;
+
+    for (uint32 bus = 0; bus < 256; ++bus)
+    {
+        for (uint32 device = 0; device < 32; ++device)
+        {
+            candidate.bus = bus;
+            candidate.device = device;
+            candidate.function = 0;
+
+            // 不存在的设备读出的厂商号为0xffff
+            if ((pci_config_read(&candidate, PCI_VENDOR_ID) & 0xffff) == 0xffff)
+            {
+                continue;
+            }
+
+            // 头部类型的第7位表示多功能设备，只有多功能设备才需要检查功能1~7
+            uint32 functions = (pci_config_read(&candidate, PCI_HEADER_TYPE) & 0x800000) ? 8 : 1;
+            for (uint32 function = 0; function < functions; ++function)
+            {
+                candidate.function = function;
+                if ((pci_config_read(&candidate, PCI_VENDOR_ID) & 0xffff) == 0xffff)
+                {
+                    continue;
+                }
+
+                uint32 value = pci_config_read(&candidate, PCI_CLASS);
+                if ((value >> 24) == classCode && ((value >> 16) & 0xff) == subclass)
+                {
+                    *address = candidate;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
@@ -9,10 +9,9 @@
 #include "os_constant.h"
 #include "memory.h"
 #include "process.h"
+#include "clock.h"
 
-const int PCB_SIZE = 4096;                   // PCB的大小，4KB。
-char PCB_SET[PCB_SIZE * MAX_PROGRAM_AMOUNT]; // 存放PCB的数组，预留了MAX_PROGRAM_AMOUNT个PCB的大小空间。
-bool PCB_SET_STATUS[MAX_PROGRAM_AMOUNT];     // PCB的分配状态，true表示已经分配，false表示未分配。
+const int PCB_SIZE = 4096; // PCB的大小，4KB，每个PCB按需从内核地址池中分配一页
 
 ProgramManager::ProgramManager()
 {
@@ -23,12 +22,33 @@ void ProgramManager::initialize()
 {
     allPrograms.initialize();
     readyPrograms.initialize();
+    freePrograms.initialize();
+    timeoutHeap.initialize();
     running = nullptr;
+    loadedPageDirectory = PAGE_DIRECTORY;
 
-    for (int i = 0; i < MAX_PROGRAM_AMOUNT; ++i)
+    for (int i = 0; i < PID_HASH_SIZE; ++i)
     {
-        PCB_SET_STATUS[i] = false;
+        pidHash[i].initialize();
     }
+    nextPid = 0;
+
+    for (int i = 0; i < MAX_RT_PRIORITY; ++i)
+    {
+        realtimePrograms[i].initialize();
+    }
+    realtimeBitmap = 0;
+    idle = nullptr;
+
+    latencyTrace = false;
+    latencyGeneration = 0;
+    latencyRing.initialize();
+    latencyDropped = 0;
+    latencyConsumed = 0;
+    latencyDroppedBase = 0;
+    latencySamples = 0;
+    totalLatency = 0;
+    maxLatency = 0;
 
     // 初始化用户代码段、数据段和栈段
     int selector;
@@ -55,10 +75,10 @@ int ProgramManager::executeThread(ThreadFunction function, void *parameter, cons
     PCB *thread = allocatePCB();
 
     if (!thread)
+    {
+        interruptManager.setInterruptStatus(status);
         return -1;
-
-    // 初始化分配的页
-    memset(thread, 0, PCB_SIZE);
+    }
 
     for (int i = 0; i < MAX_PROGRAM_NAME && name[i]; ++i)
     {
@@ -67,9 +87,10 @@ int ProgramManager::executeThread(ThreadFunction function, void *parameter, cons
 
     thread->status = ProgramStatus::READY;
     thread->priority = priority;
-    thread->ticks = priority * 10;
+    thread->timeSlice = priority * TIME_SLICE_UNIT;
+    thread->ticks = systemClock.usToTicks(thread->timeSlice);
     thread->ticksPassedBy = 0;
-    thread->pid = ((int)thread - (int)PCB_SET) / PCB_SIZE;
+    thread->parentPid = -1;
 
     // 线程栈
     thread->stack = (int *)((int)thread + PCB_SIZE - sizeof(ProcessStartStack));
@@ -82,8 +103,8 @@ int ProgramManager::executeThread(ThreadFunction function, void *parameter, cons
     thread->stack[5] = (int)program_exit;
     thread->stack[6] = (int)parameter;
 
-    allPrograms.push_back(&(thread->tagInAllList));
-    readyPrograms.push_back(&(thread->tagInGeneralList));
+    allPrograms.push_back(thread);
+    readyPrograms.push_back(thread);
 
     // 恢复中断
     interruptManager.setInterruptStatus(status);
@@ -97,7 +118,12 @@ void ProgramManager::schedule()
     bool status = interruptManager.getInterruptStatus();
     interruptManager.disableInterrupt();
 
-    if (readyPrograms.size() == 0)
+    // 检查宽限期，释放已没有读者的PCB
+    epochManager.poll();
+
+    // 没有就绪线程时当前线程继续执行，当前线程已阻塞或退出则切换到空闲线程
+    bool ready = hasReady();
+    if (!ready && (running->status == ProgramStatus::RUNNING || !idle))
     {
         interruptManager.setInterruptStatus(status);
         return;
@@ -106,31 +132,92 @@ void ProgramManager::schedule()
     if (running->status == ProgramStatus::RUNNING)
     {
         running->status = ProgramStatus::READY;
-        running->ticks = running->priority * 10;
-        readyPrograms.push_back(&(running->tagInGeneralList));
+        running->ticks = systemClock.usToTicks(running->timeSlice);
+        if (running != idle)
+        {
+            enqueueReady(running, false);
+        }
     }
     else if (running->status == ProgramStatus::DEAD)
     {
-        // 回收线程，子进程留到父进程回收
-        if(!running->pageDirectoryAddress) {
+        // 回收线程和孤儿进程，子进程留到父进程回收
+        if (!running->pageDirectoryAddress || running->parentPid == -1)
+        {
             releasePCB(running);
         }
     }
 
-    ListItem *item = readyPrograms.front();
-    PCB *next = ListItem2PCB(item, tagInGeneralList);
+    PCB *next = ready ? pickNext() : idle;
     PCB *cur = running;
     next->status = ProgramStatus::RUNNING;
     running = next;
-    readyPrograms.pop_front();
 
- 
+    if (latencyTrace && next->wakeupTime)
+    {
+        uint64 latency = systemClock.monotonicNs() - next->wakeupTime;
+        next->wakeupTime = 0;
+
+        // 只发布样本，统计由读者在线程上下文中完成
+        LatencySample sample = {latencyGeneration, (uint32)latency};
+        if (!latencyRing.push(sample))
+        {
+            ++latencyDropped;
+        }
+    }
+
     activateProgramPage(next);
     asm_switch_thread(cur, next);
 
     interruptManager.setInterruptStatus(status);
 }
 
+bool ProgramManager::hasReady()
+{
+    return realtimeBitmap || readyPrograms.front();
+}
+
+bool ProgramManager::createIdleThread()
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    int pid = executeThread(idle_thread, nullptr, "idle", 1);
+    if (pid == -1)
+    {
+        interruptManager.setInterruptStatus(status);
+        return false;
+    }
+
+    idle = allPrograms.back();
+    dequeueReady(idle);
+
+    interruptManager.setInterruptStatus(status);
+    return true;
+}
+
+void idle_thread(void *arg)
+{
+    while (true)
+    {
+        // 有线程就绪时让出CPU，空闲线程不会进入就绪队列
+        programManager.schedule();
+
+        if (memoryManager.refillZeroedPage())
+        {
+            continue;
+        }
+
+        // 检查就绪队列和停机之间不能被打断，否则中断中唤醒的线程要等到下一个中断才能运行
+        interruptManager.disableInterrupt();
+        if (programManager.hasReady())
+        {
+            interruptManager.enableInterrupt();
+            continue;
+        }
+        asm_idle();
+    }
+}
+
 void program_exit()
 {
     PCB *thread = programManager.running;
@@ -150,30 +237,424 @@ void program_exit()
 
 PCB *ProgramManager::allocatePCB()
 {
-    for (int i = 0; i < MAX_PROGRAM_AMOUNT; ++i)
+    // 优先重用已释放的PCB
+    PCB *program = freePrograms.pop_front();
+
+    if (!program)
     {
-        if (!PCB_SET_STATUS[i])
+        // 没有可重用的PCB，分配一个常驻页，PCB和内核栈不能被换出，线程数也不受LRU记录容量的限制
+        program = (PCB *)memoryManager.allocatePinnedPages(1);
+        if (!program)
         {
-            PCB_SET_STATUS[i] = true;
-            return (PCB *)((int)PCB_SET + PCB_SIZE * i);
+            return nullptr;
         }
     }
 
-    return nullptr;
+    // 初始化分配的页
+    memset(program, 0, PCB_SIZE);
+    program->children.initialize();
+    program->zombies.initialize();
+    program->childWaiting.initialize();
+
+    program->pid = allocatePid();
+    pidHash[program->pid % PID_HASH_SIZE].push_front(program);
+
+    return program;
 }
 
 void ProgramManager::releasePCB(PCB *program)
 {
-    int index = ((int)program - (int)PCB_SET) / PCB_SIZE;
-    PCB_SET_STATUS[index] = false;
-    this->allPrograms.erase(&(program->tagInAllList));
+    this->allPrograms.erase(program);
+    pidHash[program->pid % PID_HASH_SIZE].erase(program);
+    // 开中断遍历队列的读者可能仍持有该PCB，宽限期结束后再回收
+    epochManager.retire(&(program->tagInRetired), reclaim_pcb);
+}
+
+void ProgramManager::reclaimPCB(PCB *program)
+{
+    if (program->pageDirectoryAddress)
+    {
+        // 未经exit退出的进程(如复制失败的子进程)还有映射着的物理页，
+        // 它们在全局置换队列中引用着页目录表，先行释放
+        memoryManager.releaseUserPages((int *)program->pageDirectoryAddress);
+
+        // 进程的页目录表和VMA随PCB一起回收
+        memoryManager.releasePinnedPages(program->pageDirectoryAddress, 1);
+        program->userVirtual.destroy();
+    }
+
+    // 物理页不归还，留待下次分配PCB时重用
+    freePrograms.push_front(program);
+}
+
+void reclaim_pcb(EpochNode *node)
+{
+    programManager.reclaimPCB((PCB *)((int)node - (int)&((PCB *)0)->tagInRetired));
+}
+
+void ProgramManager::printPrograms()
+{
+    // 读临界区内不关中断，被摘下的PCB在离开临界区前不会被重用
+    uint32 slot = epochManager.readLock();
+
+    printf("pid  status  name\n");
+    for (PCB *program = allPrograms.front(); program; program = allPrograms.next(program))
+    {
+        printf("%d  %d  %s\n", program->pid, program->status, program->name);
+    }
+
+    epochManager.readUnlock(slot);
+}
+
+PCB *ProgramManager::findProgram(int pid)
+{
+    if (pid < 0)
+    {
+        return nullptr;
+    }
+
+    IntrusiveList<PCB, &PCB::tagInPidHash> *bucket = &pidHash[pid % PID_HASH_SIZE];
+    for (PCB *program = bucket->front(); program; program = bucket->next(program))
+    {
+        if (program->pid == pid)
+        {
+            return program;
+        }
+    }
+
+    return nullptr;
+}
+
+int ProgramManager::allocatePid()
+{
+    // pid=0留给第一个线程，回绕后从1开始，跳过仍在使用的pid
+    while (findProgram(nextPid))
+    {
+        nextPid = (nextPid + 1) % MAX_PID;
+        if (!nextPid)
+        {
+            nextPid = 1;
+        }
+    }
+
+    int pid = nextPid;
+    nextPid = (nextPid + 1) % MAX_PID;
+    if (!nextPid)
+    {
+        nextPid = 1;
+    }
+
+    return pid;
+}
+
+void ProgramManager::setTimeSlice(PCB *program, int microseconds)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    program->timeSlice = microseconds;
+    if (program->ticks > (int)systemClock.usToTicks(microseconds))
+    {
+        program->ticks = systemClock.usToTicks(microseconds);
+    }
+
+    interruptManager.setInterruptStatus(status);
 }
 
 void ProgramManager::MESA_WakeUp(PCB *program)
 {
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
     program->status = ProgramStatus::READY;
     //printf("wake up program, pid: %d\n", program->pid);
-    readyPrograms.push_front(&(program->tagInGeneralList));
+
+    if (program->policy == SchedulePolicy::SCHED_NORMAL)
+    {
+        readyPrograms.push_front(program);
+    }
+    else
+    {
+        if (latencyTrace)
+        {
+            program->wakeupTime = systemClock.monotonicNs();
+        }
+
+        enqueueReady(program, false);
+
+        // 当前线程仍在执行时才能被抢占，已阻塞或退出的线程会自行调度
+        if (running && running->status == ProgramStatus::RUNNING && shouldPreempt(program))
+        {
+            preempt();
+        }
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void ProgramManager::MESA_WakeUpAll(ProgramList *programs)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    PCB *first = nullptr;
+    PCB *program = programs->front();
+    PCB *next;
+
+    while (program)
+    {
+        next = programs->next(program);
+        program->status = ProgramStatus::READY;
+
+        // 实时线程按各自的优先级入队，普通线程留在programs中
+        if (program->policy != SchedulePolicy::SCHED_NORMAL)
+        {
+            if (latencyTrace)
+            {
+                program->wakeupTime = systemClock.monotonicNs();
+            }
+
+            programs->erase(program);
+            enqueueReady(program, false);
+            if (!first || program->rtPriority > first->rtPriority)
+            {
+                first = program;
+            }
+        }
+
+        program = next;
+    }
+
+    // 与MESA_WakeUp一致，被唤醒的普通线程放在就绪队列头部，整体一次移入并保持原有顺序
+    readyPrograms.splice_front(programs);
+
+    if (first && running && running->status == ProgramStatus::RUNNING && shouldPreempt(first))
+    {
+        preempt();
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void ProgramManager::setScheduler(PCB *program, enum SchedulePolicy policy, int rtPriority)
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    if (rtPriority < 0)
+    {
+        rtPriority = 0;
+    }
+    else if (rtPriority >= MAX_RT_PRIORITY)
+    {
+        rtPriority = MAX_RT_PRIORITY - 1;
+    }
+
+    bool ready = program->status == ProgramStatus::READY;
+    if (ready)
+    {
+        dequeueReady(program);
+    }
+
+    program->policy = policy;
+    program->rtPriority = rtPriority;
+
+    if (ready)
+    {
+        enqueueReady(program, false);
+        if (running && running->status == ProgramStatus::RUNNING && shouldPreempt(program))
+        {
+            preempt();
+        }
+    }
+    else if (program == running && running->status == ProgramStatus::RUNNING)
+    {
+        // 当前线程降低了优先级，存在更高优先级的实时线程时让出CPU
+        if (realtimeBitmap)
+        {
+            PCB *first = realtimePrograms[31 - __builtin_clz(realtimeBitmap)].front();
+            if (shouldPreempt(first))
+            {
+                preempt();
+            }
+        }
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+void ProgramManager::preempt()
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    // 被抢占的线程保留剩余时间片，回到其就绪队列的头部，空闲线程不进入就绪队列
+    running->status = ProgramStatus::READY;
+    if (running != idle)
+    {
+        enqueueReady(running, true);
+    }
+    schedule();
+
+    interruptManager.setInterruptStatus(status);
+}
+
+bool ProgramManager::addTimeout(PCB *program, uint64 deadline)
+{
+    program->timeout = deadline;
+    if (!timeoutHeap.push(program))
+    {
+        program->timeout = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void ProgramManager::cancelTimeout(PCB *program)
+{
+    timeoutHeap.erase(program);
+    program->timeout = 0;
+}
+
+void ProgramManager::expireTimeouts()
+{
+    ProgramList wakeList;
+    wakeList.initialize();
+
+    uint64 now = systemClock.getJiffies();
+    PCB *program;
+
+    // 每次时钟中断只需查看堆顶
+    while ((program = timeoutHeap.top()) && program->timeout <= now)
+    {
+        program->waitQueue->remove(program, WaitStatus::WAIT_TIMEOUT);
+        wakeList.push_back(program);
+    }
+
+    if (!wakeList.empty())
+    {
+        MESA_WakeUpAll(&wakeList);
+    }
+}
+
+void ProgramManager::enqueueReady(PCB *program, bool front)
+{
+    ProgramList *queue = &readyPrograms;
+
+    if (program->policy != SchedulePolicy::SCHED_NORMAL)
+    {
+        queue = &realtimePrograms[program->rtPriority];
+        realtimeBitmap |= (1 << program->rtPriority);
+    }
+
+    if (front)
+    {
+        queue->push_front(program);
+    }
+    else
+    {
+        queue->push_back(program);
+    }
+}
+
+void ProgramManager::dequeueReady(PCB *program)
+{
+    if (program->policy == SchedulePolicy::SCHED_NORMAL)
+    {
+        readyPrograms.erase(program);
+        return;
+    }
+
+    ProgramList *queue = &realtimePrograms[program->rtPriority];
+    queue->erase(program);
+    if (queue->empty())
+    {
+        realtimeBitmap &= ~(1 << program->rtPriority);
+    }
+}
+
+PCB *ProgramManager::pickNext()
+{
+    ProgramList *queue = &readyPrograms;
+    int level = -1;
+
+    if (realtimeBitmap)
+    {
+        level = 31 - __builtin_clz(realtimeBitmap);
+        queue = &realtimePrograms[level];
+    }
+
+    PCB *next = queue->pop_front();
+
+    if (level != -1 && queue->empty())
+    {
+        realtimeBitmap &= ~(1 << level);
+    }
+
+    return next;
+}
+
+bool ProgramManager::shouldPreempt(PCB *program)
+{
+    if (program->policy == SchedulePolicy::SCHED_NORMAL)
+    {
+        return false;
+    }
+
+    return running->policy == SchedulePolicy::SCHED_NORMAL || program->rtPriority > running->rtPriority;
+}
+
+void ProgramManager::setLatencyTrace(bool enable)
+{
+    latencyTrace = enable;
+
+    // 不取出样本，也不修改消费者的统计，latencyRing仍只有一个消费者
+    ++latencyGeneration;
+}
+
+void ProgramManager::printLatencyTrace()
+{
+    LatencySample buffer[LATENCY_RING_SIZE];
+    int count;
+
+    // 统计已被清空，从当前代数重新开始
+    uint32 generation = latencyGeneration;
+    if (generation != latencyConsumed)
+    {
+        latencyConsumed = generation;
+        latencyDroppedBase = latencyDropped;
+        latencySamples = 0;
+        totalLatency = 0;
+        maxLatency = 0;
+    }
+
+    // 成批取出调度器发布的样本，不需要关中断
+    while ((count = latencyRing.popBatch(buffer, LATENCY_RING_SIZE)))
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            // 清空统计前产生的样本
+            if (buffer[i].generation != generation)
+            {
+                continue;
+            }
+
+            ++latencySamples;
+            totalLatency += buffer[i].latency;
+            if (buffer[i].latency > maxLatency)
+            {
+                maxLatency = buffer[i].latency;
+            }
+        }
+    }
+
+    uint32 samples = latencySamples;
+    uint32 average = samples ? (uint32)asm_udiv64(totalLatency, samples) : 0;
+    uint32 maximum = (uint32)maxLatency;
+    uint32 dropped = latencyDropped - latencyDroppedBase;
+
+    printf("wakeup latency: samples %d, avg %d ns, max %d ns, dropped %d\n", samples, average, maximum, dropped);
 }
 
 void ProgramManager::initializeTSS()
@@ -213,7 +694,18 @@ int ProgramManager::executeProcess(const char *filename, int priority)
     }
 
     // 找到刚刚创建的PCB
-    PCB *process = ListItem2PCB(allPrograms.back(), tagInAllList);
+    PCB *process = allPrograms.back();
+
+    // 创建者成为新进程的父进程
+    if (running)
+    {
+        process->parentPid = running->pid;
+        running->children.push_back(process);
+    }
+    else
+    {
+        process->parentPid = -1;
+    }
 
     // 创建进程的页目录表
     process->pageDirectoryAddress = createProcessPageDirectory();
@@ -221,7 +713,7 @@ int ProgramManager::executeProcess(const char *filename, int priority)
 
     if (!process->pageDirectoryAddress)
     {
-        process->status = ProgramStatus::DEAD;
+        discardProcess(process);
         interruptManager.setInterruptStatus(status);
         return -1;
     }
@@ -231,7 +723,7 @@ int ProgramManager::executeProcess(const char *filename, int priority)
 
     if (!res)
     {
-        process->status = ProgramStatus::DEAD;
+        discardProcess(process);
         interruptManager.setInterruptStatus(status);
         return -1;
     }
@@ -243,16 +735,14 @@ int ProgramManager::executeProcess(const char *filename, int priority)
 
 int ProgramManager::createProcessPageDirectory()
 {
-    // 从内核地址池中分配一页存储用户进程的页目录表
-    int vaddr = memoryManager.allocatePages(AddressPoolType::KERNEL, 1);
+    // 分配一个已清零的常驻页存储用户进程的页目录表，页目录表不能被换出
+    int vaddr = memoryManager.allocatePinnedPages(1, true);
     if (!vaddr)
     {
         //printf("can not create page from kernel\n");
         return 0;
     }
 
-    memset((char *)vaddr, 0, PAGE_SIZE);
-
     // 复制内核目录项到虚拟地址的高1GB
     int *src = (int *)(0xfffff000 + 0x300 * 4);
     int *dst = (int *)(vaddr + 0x300 * 4);
@@ -269,22 +759,8 @@ int ProgramManager::createProcessPageDirectory()
 
 bool ProgramManager::createUserVirtualPool(PCB *process)
 {
-    int sourcesCount = (0xc0000000 - USER_VADDR_START) / PAGE_SIZE;
-    int bitmapLength = ceil(sourcesCount, 8);
-
-    // 计算位图所占的页数
-    int pagesCount = ceil(bitmapLength, PAGE_SIZE);
-
-    int start = memoryManager.allocatePages(AddressPoolType::KERNEL, pagesCount);
-    //printf("%x %d\n", start, pagesCount);
-
-    if (!start)
-    {
-        return false;
-    }
-
-    memset((char *)start, 0, PAGE_SIZE * pagesCount);
-    (process->userVirtual).initialize((char *)start, sourcesCount, USER_VADDR_START);
+    // 地址空间初始为空，VMA在分配虚拟页时按需创建
+    (process->userVirtual).initialize(USER_VADDR_START, 0xc0000000);
 
     return true;
 }
@@ -340,14 +816,25 @@ void load_process(const char *filename)
 
 void ProgramManager::activateProgramPage(PCB *program)
 {
-    int paddr = PAGE_DIRECTORY;
+    // 所有页目录表的内核部分都相同，内核线程只访问内核地址空间，
+    // 因此沿用当前页目录表，保留TLB中的表项
+    if (!program->pageDirectoryAddress)
+    {
+        return;
+    }
 
-    if (program->pageDirectoryAddress)
+    tss.esp0 = (int)program + PAGE_SIZE;
+    loadPageDirectory(memoryManager.vaddr2paddr(program->pageDirectoryAddress));
+}
+
+void ProgramManager::loadPageDirectory(int paddr)
+{
+    if (paddr == loadedPageDirectory)
     {
-        tss.esp0 = (int)program + PAGE_SIZE;
-        paddr = memoryManager.vaddr2paddr(program->pageDirectoryAddress);
+        return;
     }
 
+    loadedPageDirectory = paddr;
     asm_update_cr3(paddr);
 }
 
@@ -371,12 +858,12 @@ int ProgramManager::fork()
         return -1;
     }
 
-    PCB *child = ListItem2PCB(this->allPrograms.back(), tagInAllList);
+    PCB *child = this->allPrograms.back();
     bool flag = copyProcess(parent, child);
 
     if (!flag)
     {
-        child->status = ProgramStatus::DEAD;
+        discardProcess(child);
         interruptManager.setInterruptStatus(status);
         return -1;
     }
@@ -405,14 +892,17 @@ bool ProgramManager::copyProcess(PCB *parent, PCB *child)
     child->status = ProgramStatus::READY;
     child->parentPid = parent->pid;
     child->priority = parent->priority;
+    child->timeSlice = parent->timeSlice;
     child->ticks = parent->ticks;
     child->ticksPassedBy = parent->ticksPassedBy;
     strcpy(parent->name, child->name);
 
-    // 复制用户虚拟地址池
-    int bitmapLength = parent->userVirtual.resources.length;
-    int bitmapBytes = ceil(bitmapLength, 8);
-    memcpy(parent->userVirtual.resources.bitmap, child->userVirtual.resources.bitmap, bitmapBytes);
+    // 复制用户虚拟地址空间的VMA
+    if (!child->userVirtual.copy(&(parent->userVirtual)))
+    {
+        child->status = ProgramStatus::DEAD;
+        return false;
+    }
 
     char *buffer = (char *)memoryManager.allocatePages(AddressPoolType::KERNEL, 1);
     if (!buffer)
@@ -441,24 +931,20 @@ bool ProgramManager::copyProcess(PCB *parent, PCB *child)
             continue;
         }
 
-        // 从用户物理地址池中分配一页，作为子进程的页目录项指向的页表
-        int paddr = memoryManager.allocatePhysicalPages(AddressPoolType::USER, 1);
+        // 分配一个已清零的页，作为子进程的页目录项指向的页表
+        // 页目录表在内核地址空间中，不需要切换到子进程的地址空间
+        int paddr = memoryManager.allocateZeroedPage(AddressPoolType::USER);
         if (!paddr)
         {
+            memoryManager.releasePages(AddressPoolType::KERNEL, (int)buffer, 1);
             child->status = ProgramStatus::DEAD;
             return false;
         }
         // 页目录项
         int pde = parentPageDir[i];
-        // 构造页表的起始虚拟地址
-        int *pageTableVaddr = (int *)(0xffc00000 + (i << 12));
-
-        asm_update_cr3(childPageDirPaddr); // 进入子进程虚拟地址空间
 
         childPageDir[i] = (pde & 0x00000fff) | paddr;
-        memset(pageTableVaddr, 0, PAGE_SIZE);
-
-        asm_update_cr3(parentPageDirPaddr); // 回到父进程虚拟地址空间
+        memoryManager.paddrToPage(paddr)->flags |= PG_TABLE;
     }
 
     for (int i = 0; i < 768; ++i)
@@ -485,23 +971,53 @@ bool ProgramManager::copyProcess(PCB *parent, PCB *child)
             int paddr = memoryManager.allocatePhysicalPages(AddressPoolType::USER, 1);
             if (!paddr)
             {
+                memoryManager.releasePages(AddressPoolType::KERNEL, (int)buffer, 1);
                 child->status = ProgramStatus::DEAD;
                 return false;
             }
 
             // 构造物理页的起始虚拟地址
             void *pageVaddr = (void *)((i << 22) + (j << 12));
-            memcpy(pageVaddr, buffer, PAGE_SIZE);
+            copy_page(pageVaddr, buffer);
             // 页表项
             int pte = pageTableVaddr[j];
 
-            asm_update_cr3(childPageDirPaddr); // 进入子进程虚拟地址空间
+            loadPageDirectory(childPageDirPaddr); // 进入子进程虚拟地址空间
 
             pageTableVaddr[j] = (pte & 0x00000fff) | paddr;
-            memcpy(buffer, pageVaddr, PAGE_SIZE);
+            memoryManager.mapPhysicalPage(paddr, child, (int)pageVaddr);
+            copy_page(buffer, pageVaddr);
+
+            loadPageDirectory(parentPageDirPaddr); // 回到父进程虚拟地址空间
+        }
+    }
 
-            asm_update_cr3(parentPageDirPaddr); // 回到父进程虚拟地址空间
+    // 复制已换出的页，子进程在交换区中得到独立的副本
+    uint32 vpn = 0;
+    PageMeta *meta;
+    while ((meta = (PageMeta *)parent->userVirtual.pages.next(&vpn)))
+    {
+        if (meta->state == PAGE_SWAPPED)
+        {
+            PageMeta *copied = (PageMeta *)memoryManager.pageMetaCache.allocate();
+            if (!copied)
+            {
+                memoryManager.releasePages(AddressPoolType::KERNEL, (int)buffer, 1);
+                child->status = ProgramStatus::DEAD;
+                return false;
+            }
+
+            *copied = *meta;
+            copied->swapSlot = memoryManager.copySwapSlot(meta->swapSlot, buffer);
+            if (copied->swapSlot == -1 || !child->userVirtual.pages.insert(vpn, copied))
+            {
+                release_page_meta(copied);
+                memoryManager.releasePages(AddressPoolType::KERNEL, (int)buffer, 1);
+                child->status = ProgramStatus::DEAD;
+                return false;
+            }
         }
+        ++vpn;
     }
 
     // 归还从内核分配的页表
@@ -545,49 +1061,78 @@ void ProgramManager::exit(int ret)
 
             paddr = memoryManager.vaddr2paddr((int)page);
             memoryManager.releasePhysicalPages(AddressPoolType::USER, paddr, 1);
+            // 回收PCB时不再重复释放
+            pageDir[i] = 0;
         }
 
-        memoryManager.releasePages(AddressPoolType::KERNEL, (int)pageDir, 1);
-
-        int bitmapBytes = ceil(program->userVirtual.resources.length, 8);
-        int bitmapPages = ceil(bitmapBytes, PAGE_SIZE);
-
-        memoryManager.releasePages(AddressPoolType::KERNEL, (int)program->userVirtual.resources.bitmap, bitmapPages);
+        // 切换回内核页目录表，页目录表和位图在PCB被回收时释放
+        loadPageDirectory(PAGE_DIRECTORY);
     }
 
+    notifyExit(program);
     schedule();
 }
 
-int ProgramManager::wait(int *retval)
+void ProgramManager::notifyExit(PCB *program)
 {
     PCB *child;
-    ListItem *item;
-    bool interrupt, flag;
 
-    while (true)
+    // 已退出的子进程不再有父进程回收，直接释放
+    while ((child = program->zombies.pop_front()))
     {
-        interrupt = interruptManager.getInterruptStatus();
-        interruptManager.disableInterrupt();
+        releasePCB(child);
+    }
 
-        item = this->allPrograms.head.next;
+    // 未退出的子进程成为孤儿进程，退出时由调度器回收
+    while ((child = program->children.pop_front()))
+    {
+        child->parentPid = -1;
+    }
 
-        // 查找子进程
-        flag = true;
-        while (item)
-        {
-            child = ListItem2PCB(item, tagInAllList);
-            if (child->parentPid == this->running->pid)
-            {
-                flag = false;
-                if (child->status == ProgramStatus::DEAD)
-                {
-                    break;
-                }
-            }
-            item = item->next;
-        }
+    PCB *parent = findProgram(program->parentPid);
+    if (!parent)
+    {
+        program->parentPid = -1;
+        return;
+    }
+
+    // 移入父进程的待回收队列，并唤醒等待子进程退出的父进程
+    parent->children.erase(program);
+    parent->zombies.push_back(program);
 
-        if (item) // 找到一个可返回的子进程
+    parent->childWaiting.wakeUpAll();
+}
+
+void ProgramManager::discardProcess(PCB *process)
+{
+    process->status = ProgramStatus::DEAD;
+
+    // 创建失败的进程不会被调度，也不会经exit进入父进程的待回收队列
+    PCB *parent = findProgram(process->parentPid);
+    if (parent)
+    {
+        parent->children.erase(process);
+    }
+    process->parentPid = -1;
+    dequeueReady(process);
+
+    // 已复制的物理页和页目录表在回收PCB时释放
+    releasePCB(process);
+}
+
+int ProgramManager::wait(int *retval)
+{
+    bool interrupt = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    PCB *parent = this->running;
+    PCB *child;
+
+    while (true)
+    {
+        // 回收一个已退出的子进程
+        child = parent->zombies.pop_front();
+        if (child)
         {
             if (retval)
             {
@@ -599,19 +1144,15 @@ int ProgramManager::wait(int *retval)
             interruptManager.setInterruptStatus(interrupt);
             return pid;
         }
-        else 
+
+        // 没有子进程
+        if (!parent->children.front())
         {
-            if (flag) // 子进程已经返回
-            {
-                
-                interruptManager.setInterruptStatus(interrupt);
-                return -1;
-            }
-            else // 存在子进程，但子进程的状态不是DEAD
-            {
-                interruptManager.setInterruptStatus(interrupt);
-                schedule();
-            }
+            interruptManager.setInterruptStatus(interrupt);
+            return -1;
         }
+
+        // 存在子进程，但子进程都未退出，阻塞直到子进程退出时被唤醒
+        parent->childWaiting.sleep(nullptr, 0, false);
     }
 }
@@ -0,0 +1,201 @@
+#include "radix_tree.h"
+#include "asm_utils.h"
+#include "os_modules.h"
+#include "memory.h"
+
+void RadixTree::initialize()
+{
+    root = nullptr;
+}
+
+void *RadixTree::lookup(uint32 key)
+{
+    RadixNode *node = root;
+
+    for (int level = RADIX_TREE_HEIGHT - 1; node && level > 0; --level)
+    {
+        node = (RadixNode *)node->slots[(key >> (level * RADIX_TREE_SHIFT)) & RADIX_TREE_MASK];
+    }
+
+    return node ? node->slots[key & RADIX_TREE_MASK] : nullptr;
+}
+
+bool RadixTree::insert(uint32 key, void *item)
+{
+    if (!root)
+    {
+        RadixNode *node = createNode();
+        if (!node)
+        {
+            return false;
+        }
+        root = node;
+    }
+
+    RadixNode *node = root;
+    for (int level = RADIX_TREE_HEIGHT - 1; level > 0; --level)
+    {
+        int index = (key >> (level * RADIX_TREE_SHIFT)) & RADIX_TREE_MASK;
+        RadixNode *child = (RadixNode *)node->slots[index];
+        if (!child)
+        {
+            child = createNode();
+            if (!child)
+            {
+                return false;
+            }
+            node->slots[index] = child;
+            ++node->count;
+        }
+        node = child;
+    }
+
+    int index = key & RADIX_TREE_MASK;
+    if (node->slots[index])
+    {
+        return false;
+    }
+
+    // 元素的内容对并发的读者可见后再链入
+    asm_memory_barrier();
+    node->slots[index] = item;
+    ++node->count;
+    return true;
+}
+
+void *RadixTree::remove(uint32 key)
+{
+    RadixNode *path[RADIX_TREE_HEIGHT];
+    RadixNode *node = root;
+
+    for (int level = RADIX_TREE_HEIGHT - 1; level >= 0; --level)
+    {
+        if (!node)
+        {
+            return nullptr;
+        }
+        path[level] = node;
+        if (level > 0)
+        {
+            node = (RadixNode *)node->slots[(key >> (level * RADIX_TREE_SHIFT)) & RADIX_TREE_MASK];
+        }
+    }
+
+    int index = key & RADIX_TREE_MASK;
+    void *item = path[0]->slots[index];
+    if (!item)
+    {
+        return nullptr;
+    }
+
+    path[0]->slots[index] = nullptr;
+    --path[0]->count;
+
+    // 自底向上摘下空结点，读者可能还在访问，宽限期后再释放
+    for (int level = 0; level < RADIX_TREE_HEIGHT && path[level]->count == 0; ++level)
+    {
+        if (level == RADIX_TREE_HEIGHT - 1)
+        {
+            root = nullptr;
+        }
+        else
+        {
+            path[level + 1]->slots[(key >> ((level + 1) * RADIX_TREE_SHIFT)) & RADIX_TREE_MASK] = nullptr;
+            --path[level + 1]->count;
+        }
+        epochManager.retire(&(path[level]->tagInRetired), reclaim_radix_node);
+    }
+
+    return item;
+}
+
+void *RadixTree::next(uint32 *key)
+{
+    RadixNode *node = root;
+    return node ? scan(node, RADIX_TREE_HEIGHT - 1, key) : nullptr;
+}
+
+void RadixTree::destroy(void (*release)(void *item))
+{
+    if (root)
+    {
+        destroyNode(root, RADIX_TREE_HEIGHT - 1, release);
+        root = nullptr;
+    }
+}
+
+RadixNode *RadixTree::createNode()
+{
+    RadixNode *node = (RadixNode *)memoryManager.radixNodeCache.allocate();
+    if (!node)
+    {
+        return nullptr;
+    }
+
+    node->count = 0;
+    for (int i = 0; i < RADIX_TREE_SLOTS; ++i)
+    {
+        node->slots[i] = nullptr;
+    }
+    asm_memory_barrier();
+    return node;
+}
+
+void *RadixTree::scan(RadixNode *node, int level, uint32 *key)
+{
+    int shift = level * RADIX_TREE_SHIFT;
+
+    for (uint32 i = (*key >> shift) & RADIX_TREE_MASK; i < (uint32)RADIX_TREE_SLOTS; ++i)
+    {
+        void *slot = node->slots[i];
+        if (slot)
+        {
+            if (level == 0)
+            {
+                return slot;
+            }
+
+            void *item = scan((RadixNode *)slot, level - 1, key);
+            if (item)
+            {
+                return item;
+            }
+        }
+
+        // 下一个槽位从它覆盖的最小的键开始，最后一个槽位之后进位到上一层
+        *key = (*key & ~(((uint32)RADIX_TREE_SLOTS << shift) - 1)) | ((i + 1) << shift);
+    }
+
+    return nullptr;
+}
+
+void RadixTree::destroyNode(RadixNode *node, int level, void (*release)(void *item))
+{
+    for (int i = 0; i < RADIX_TREE_SLOTS; ++i)
+    {
+        void *slot = node->slots[i];
+        if (!slot)
+        {
+            continue;
+        }
+
+        if (level == 0)
+        {
+            if (release)
+            {
+                release(slot);
+            }
+        }
+        else
+        {
+            destroyNode((RadixNode *)slot, level - 1, release);
+        }
+    }
+
+    memoryManager.radixNodeCache.release(node);
+}
+
+void reclaim_radix_node(EpochNode *node)
+{
+    memoryManager.radixNodeCache.release((RadixNode *)((int)node - (int)&((RadixNode *)0)->tagInRetired));
+}
@@ -9,6 +9,9 @@
 #include "tss.h"
 #include "disk.h"
 #include "stdlib.h"
+#include "clock.h"
+#include "futex.h"
+#include "epoch.h"
 
 // 屏幕IO处理器
 STDIO stdio;
@@ -22,6 +25,12 @@ MemoryManager memoryManager;
 SystemService systemService;
 // Task State Segment
 TSS tss;
+// 系统时钟
+SystemClock systemClock;
+// futex等待队列
+FutexManager futexManager;
+// 延迟释放
+EpochManager epochManager;
 
 int syscall_0(int first, int second, int third, int forth, int fifth)
 {
@@ -84,9 +93,15 @@ extern "C" void setup_kernel()
     interruptManager.setTimeInterrupt((void *)asm_time_interrupt_handler);
     // 设置页错误中断的中断描述符
     interruptManager.setInterruptDescriptor(14, (uint)asm_pageFault_handler, 0);
+    // 设置时钟中断频率并校准TSC
+    systemClock.initialize(TIMER_FREQUENCY);
     // 输出管理器
     stdio.initialize();
+    // 根据CPU特性选择页复制和清零的实现
+    select_page_routines();
 
+    // 延迟释放
+    epochManager.initialize();
     // 进程/线程管理器
     programManager.initialize();
 
@@ -102,9 +117,18 @@ extern "C" void setup_kernel()
     systemService.setSystemCall(3, (int)syscall_exit);
     // 设置4号系统调用
     systemService.setSystemCall(4, (int)syscall_wait);
+    // 设置5号系统调用
+    systemService.setSystemCall(5, (int)syscall_futex_wait);
+    // 设置6号系统调用
+    systemService.setSystemCall(6, (int)syscall_futex_wake);
+    // 设置7号系统调用
+    systemService.setSystemCall(7, (int)syscall_lockstat);
+    futexManager.initialize();
 
     // 内存管理器
     memoryManager.initialize();
+    // 硬盘驱动，调度器运行后由IRQ14完成请求
+    Disk::initialize();
 
     // 创建第一个线程
     int pid = programManager.executeThread(first_thread, nullptr, "first thread", 1);
@@ -114,10 +138,15 @@ extern "C" void setup_kernel()
         asm_halt();
     }
 
-    ListItem *item = programManager.readyPrograms.front();
-    PCB *firstThread = ListItem2PCB(item, tagInGeneralList);
+    // 创建空闲线程，它不在就绪队列中，只在没有其他线程可运行时执行
+    if (!programManager.createIdleThread())
+    {
+        printf("can not create idle thread\n");
+        asm_halt();
+    }
+
+    PCB *firstThread = programManager.readyPrograms.pop_front();
     firstThread->status = ProgramStatus::RUNNING;
-    programManager.readyPrograms.pop_front();
     programManager.running = firstThread;
     asm_switch_thread(0, firstThread);
 
@@ -0,0 +1,88 @@
+#include "slab.h"
+#include "os_constant.h"
+#include "os_modules.h"
+#include "memory.h"
+
+void SlabCache::initialize(int objectSize)
+{
+    if (objectSize < (int)sizeof(void *))
+    {
+        objectSize = sizeof(void *);
+    }
+    this->objectSize = (objectSize + 3) & ~3;
+    objectsPerPage = (PAGE_SIZE - (int)sizeof(SlabPage)) / this->objectSize;
+    partial.initialize();
+}
+
+void *SlabCache::allocate()
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    SlabPage *page = partial.front();
+    if (!page)
+    {
+        // 缺页处理通过slab中的基数树结点和元数据查找换出的页，slab页必须常驻
+        page = (SlabPage *)memoryManager.allocatePinnedPages(1);
+        if (!page)
+        {
+            interruptManager.setInterruptStatus(status);
+            return nullptr;
+        }
+
+        // 将页内的对象串成空闲链表
+        char *object = (char *)page + sizeof(SlabPage);
+        page->freeObjects = nullptr;
+        for (int i = objectsPerPage - 1; i >= 0; --i)
+        {
+            *(void **)(object + i * objectSize) = page->freeObjects;
+            page->freeObjects = object + i * objectSize;
+        }
+        page->inUse = 0;
+        partial.push_front(page);
+    }
+
+    void *object = page->freeObjects;
+    page->freeObjects = *(void **)object;
+    ++page->inUse;
+
+    if (!page->freeObjects)
+    {
+        partial.erase(page);
+    }
+
+    interruptManager.setInterruptStatus(status);
+    return object;
+}
+
+void SlabCache::release(void *object)
+{
+    if (!object)
+    {
+        return;
+    }
+
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+
+    SlabPage *page = (SlabPage *)((int)object & ~(PAGE_SIZE - 1));
+
+    // 满页重新有了空闲对象
+    if (!page->freeObjects)
+    {
+        partial.push_front(page);
+    }
+
+    *(void **)object = page->freeObjects;
+    page->freeObjects = object;
+    --page->inUse;
+
+    // 空页归还给内核，保留最后一个有空闲对象的页以免反复分配
+    if (page->inUse == 0 && partial.size() > 1)
+    {
+        partial.erase(page);
+        memoryManager.releasePinnedPages((int)page, 1);
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
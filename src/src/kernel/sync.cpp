@@ -11,23 +11,67 @@ SpinLock::SpinLock()
 
 void SpinLock::initialize()
 {
-    bolt = 0;
+    next = 0;
+    owner = 0;
+#ifdef LOCKSTAT
+    lockstat_initialize(&stat, nullptr);
+#endif
+}
+
+void SpinLock::setName(const char *name)
+{
+#ifdef LOCKSTAT
+    lockstat_initialize(&stat, name);
+#endif
 }
 
 void SpinLock::lock()
 {
-    uint32 key = 1;
+    // 取号，等待叫到自己的号码
+    uint32 ticket = asm_atomic_fetch_add(&next, 1);
 
-    do
+#ifdef LOCKSTAT
+    if (owner != ticket)
     {
-        asm_atomic_exchange(&key, &bolt);
+        uint64 start = asm_read_tsc();
+        while (owner != ticket)
+        {
+            asm_cpu_pause();
+        }
+        lockstat_acquired(&stat, true, asm_read_tsc() - start);
+        return;
+    }
+    lockstat_acquired(&stat, false, 0);
+#endif
+
+    while (owner != ticket)
+    {
+        asm_cpu_pause();
         //printf("pid: %d\n", programManager.running->pid);
-    } while (key);
+    }
 }
 
 void SpinLock::unlock()
 {
-    bolt = 0;
+#ifdef LOCKSTAT
+    lockstat_released(&stat);
+#endif
+    // 只有持有者会修改owner
+    owner = owner + 1;
+}
+
+bool SpinLock::lockIrqSave()
+{
+    bool status = interruptManager.getInterruptStatus();
+    interruptManager.disableInterrupt();
+    lock();
+    return status;
+}
+
+void SpinLock::unlockIrqRestore(bool status)
+{
+    unlock();
+    interruptManager.setInterruptStatus(status);
 }
 
 Semaphore::Semaphore()
@@ -40,44 +84,411 @@ void Semaphore::initialize(uint32 counter)
     this->counter = counter;
     semLock.initialize();
     waiting.initialize();
+#ifdef LOCKSTAT
+    lockstat_initialize(&stat, nullptr);
+#endif
 }
 
-void Semaphore::P()
+void Semaphore::setName(const char *name)
 {
-    PCB *cur = nullptr;
+#ifdef LOCKSTAT
+    lockstat_initialize(&stat, name);
+#endif
+}
+
+int Semaphore::P(int timeout)
+{
+    bool status;
+    // 被唤醒后可能又被其他线程抢先获得，重新等待时不延长超时时刻
+    uint64 deadline = WaitQueue::toDeadline(timeout);
+#ifdef LOCKSTAT
+    uint64 start = 0;
+#endif
 
     while (true)
     {
-        semLock.lock();
+        status = semLock.lockIrqSave();
         if (counter > 0)
         {
             --counter;
-            semLock.unlock();
-            return;
+#ifdef LOCKSTAT
+            lockstat_acquired(&stat, start != 0, start ? asm_read_tsc() - start : 0);
+#endif
+            semLock.unlockIrqRestore(status);
+            return WaitStatus::WAIT_OK;
         }
 
-        cur = programManager.running;
-        waiting.push_back(&(cur->tagInGeneralList));
-        cur->status = ProgramStatus::BLOCKED;
+#ifdef LOCKSTAT
+        if (!start)
+        {
+            start = asm_read_tsc();
+        }
+#endif
 
-        semLock.unlock();
-        programManager.schedule();
+        if (waiting.sleep(&semLock, deadline) == WaitStatus::WAIT_TIMEOUT)
+        {
+            interruptManager.setInterruptStatus(status);
+            return WaitStatus::WAIT_TIMEOUT;
+        }
+        interruptManager.setInterruptStatus(status);
     }
 }
 
 void Semaphore::V()
 {
-    semLock.lock();
+    bool status = semLock.lockIrqSave();
+#ifdef LOCKSTAT
+    lockstat_released(&stat);
+#endif
     ++counter;
-    if (waiting.size())
+    semLock.unlock();
+
+    // 保持关中断，唤醒引起的抢占不会发生在持有semLock期间
+    waiting.wakeUp(1);
+    interruptManager.setInterruptStatus(status);
+}
+
+Mutex::Mutex()
+{
+    initialize();
+}
+
+void Mutex::initialize()
+{
+    state = 0;
+    owner = nullptr;
+    waiting.initialize();
+    waitLock.initialize();
+    boosted = false;
+#ifdef LOCKSTAT
+    lockstat_initialize(&stat, nullptr);
+#endif
+}
+
+void Mutex::setName(const char *name)
+{
+#ifdef LOCKSTAT
+    lockstat_initialize(&stat, name);
+#endif
+}
+
+bool Mutex::tryLock()
+{
+    if (asm_atomic_cmpxchg(&state, 0, 1) == 0)
     {
-        PCB *program = ListItem2PCB(waiting.front(), tagInGeneralList);
-        waiting.pop_front();
-        semLock.unlock();
-        programManager.MESA_WakeUp(program);
+        owner = programManager.running;
+#ifdef LOCKSTAT
+        lockstat_acquired(&stat, false, 0);
+#endif
+        return true;
+    }
+
+    return false;
+}
+
+void Mutex::lock()
+{
+    // 快速路径：没有竞争时一次cmpxchg即可获得锁
+    if (tryLock())
+    {
+        return;
+    }
+
+    PCB *cur = programManager.running;
+#ifdef LOCKSTAT
+    uint64 start = asm_read_tsc();
+#endif
+    bool status = waitLock.lockIrqSave();
+
+    // 标记存在等待者，若锁恰好已被释放则直接获得
+    uint32 value = 2;
+    asm_atomic_exchange(&value, (uint32 *)&state);
+    if (value == 0)
+    {
+        owner = cur;
+#ifdef LOCKSTAT
+        lockstat_acquired(&stat, true, asm_read_tsc() - start);
+#endif
+        waitLock.unlockIrqRestore(status);
+        return;
+    }
+
+    // 先标记为阻塞再提升持有者，提升不会引起当前线程被抢占
+    cur->status = ProgramStatus::BLOCKED;
+    if (owner && higher_priority(cur, owner))
+    {
+        boost(cur);
+    }
+
+    // 按优先级进入等待队列，被唤醒时锁已经交给当前线程
+    waiting.sleep(&waitLock, 0);
+#ifdef LOCKSTAT
+    lockstat_acquired(&stat, true, asm_read_tsc() - start);
+#endif
+    interruptManager.setInterruptStatus(status);
+}
+
+void Mutex::unlock()
+{
+    PCB *cur = programManager.running;
+
+#ifdef LOCKSTAT
+    lockstat_released(&stat);
+#endif
+
+    // 快速路径：没有等待者
+    owner = nullptr;
+    if (asm_atomic_cmpxchg(&state, 1, 0) == 1)
+    {
+        return;
+    }
+
+    bool status = waitLock.lockIrqSave();
+
+    bool restore = boosted;
+    int priority = savedPriority;
+    int timeSlice = savedTimeSlice;
+    enum SchedulePolicy policy = savedPolicy;
+    int rtPriority = savedRtPriority;
+    boosted = false;
+
+    PCB *next = waiting.front();
+    if (next)
+    {
+        // 直接把锁交给优先级最高的等待者
+        waiting.remove(next, WaitStatus::WAIT_OK);
+        owner = next;
+        state = waiting.empty() ? 1 : 2;
+
+        // 新的持有者继承剩余等待者中的最高优先级
+        PCB *waiter = waiting.front();
+        if (waiter && higher_priority(waiter, next))
+        {
+            boost(waiter);
+        }
     }
     else
     {
-        semLock.unlock();
+        state = 0;
+    }
+
+    waitLock.unlock();
+
+    if (next)
+    {
+        programManager.MESA_WakeUp(next);
+    }
+
+    // 恢复被提升前的调度参数，可能因此被更高优先级的线程抢占
+    if (restore)
+    {
+        cur->priority = priority;
+        cur->timeSlice = timeSlice;
+        if (cur->policy != policy || cur->rtPriority != rtPriority)
+        {
+            programManager.setScheduler(cur, policy, rtPriority);
+        }
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+PCB *Mutex::getOwner()
+{
+    return owner;
+}
+
+void Mutex::boost(PCB *waiter)
+{
+    if (!boosted)
+    {
+        boosted = true;
+        savedPriority = owner->priority;
+        savedTimeSlice = owner->timeSlice;
+        savedPolicy = owner->policy;
+        savedRtPriority = owner->rtPriority;
+    }
+
+    if (waiter->priority > owner->priority)
+    {
+        owner->priority = waiter->priority;
+        owner->timeSlice = waiter->timeSlice;
     }
+
+    if (waiter->policy != SchedulePolicy::SCHED_NORMAL &&
+        (owner->policy == SchedulePolicy::SCHED_NORMAL || waiter->rtPriority > owner->rtPriority))
+    {
+        programManager.setScheduler(owner, waiter->policy, waiter->rtPriority);
+    }
+}
+
+ConditionVariable::ConditionVariable()
+{
+    initialize();
+}
+
+void ConditionVariable::initialize()
+{
+    waiting.initialize();
+    guard.initialize();
+}
+
+int ConditionVariable::wait(Mutex &mutex, int timeout)
+{
+    bool status = guard.lockIrqSave();
+    uint64 deadline = WaitQueue::toDeadline(timeout);
+
+    // 先进入等待队列再释放mutex，释放后到来的signal不会丢失
+    waiting.enqueue(deadline);
+    guard.unlock();
+
+    mutex.unlock();
+    int result = waiting.block(nullptr);
+    interruptManager.setInterruptStatus(status);
+
+    mutex.lock();
+    return result;
+}
+
+void ConditionVariable::signal()
+{
+    bool status = guard.lockIrqSave();
+    guard.unlock();
+
+    // 保持关中断，唤醒引起的抢占不会发生在持有guard期间
+    waiting.wakeUp(1);
+    interruptManager.setInterruptStatus(status);
+}
+
+void ConditionVariable::broadcast()
+{
+    bool status = guard.lockIrqSave();
+    guard.unlock();
+
+    // 普通线程整体一次移入就绪队列
+    waiting.wakeUpAll();
+    interruptManager.setInterruptStatus(status);
+}
+
+RWLock::RWLock()
+{
+    initialize();
+}
+
+void RWLock::initialize()
+{
+    readers = 0;
+    writer = false;
+    waitingWriters = 0;
+    readWaiting.initialize();
+    writeWaiting.initialize();
+    guard.initialize();
+}
+
+void RWLock::sleep(WaitQueue *queue, bool exclusive)
+{
+    queue->sleep(&guard, 0, exclusive);
+    guard.lock();
+}
+
+void RWLock::readLock()
+{
+    bool status = guard.lockIrqSave();
+
+    // 有写者持有或等待写锁时，新的读者让步
+    while (writer || waitingWriters)
+    {
+        sleep(&readWaiting, false);
+    }
+    ++readers;
+
+    guard.unlockIrqRestore(status);
+}
+
+void RWLock::readUnlock()
+{
+    bool status = guard.lockIrqSave();
+
+    --readers;
+    guard.unlock();
+
+    if (!readers)
+    {
+        writeWaiting.wakeUp(1);
+    }
+    interruptManager.setInterruptStatus(status);
+}
+
+void RWLock::writeLock()
+{
+    bool status = guard.lockIrqSave();
+
+    ++waitingWriters;
+    while (writer || readers)
+    {
+        sleep(&writeWaiting, true);
+    }
+    --waitingWriters;
+    writer = true;
+
+    guard.unlockIrqRestore(status);
+}
+
+void RWLock::writeUnlock()
+{
+    bool status = guard.lockIrqSave();
+
+    writer = false;
+    // 保持关中断，唤醒引起的抢占不会发生在持有guard期间
+    guard.unlock();
+
+    // 优先唤醒写者，没有写者时唤醒所有等待的读者
+    if (!writeWaiting.wakeUp(1))
+    {
+        readWaiting.wakeUpAll();
+    }
+
+    interruptManager.setInterruptStatus(status);
+}
+
+SeqLock::SeqLock()
+{
+    initialize();
+}
+
+void SeqLock::initialize()
+{
+    sequence = 0;
+    writeLock.initialize();
+}
+
+uint32 SeqLock::readBegin()
+{
+    uint32 start;
+
+    // 写者持有锁期间关中断，单处理器上读者不会看到奇数序号，这里只为多处理器等待
+    while ((start = sequence) & 1)
+    {
+        asm_cpu_pause();
+    }
+
+    return start;
+}
+
+bool SeqLock::readRetry(uint32 start)
+{
+    return sequence != start;
+}
+
+bool SeqLock::writeBegin()
+{
+    bool status = writeLock.lockIrqSave();
+    sequence = sequence + 1;
+    return status;
+}
+
+void SeqLock::writeEnd(bool status)
+{
+    sequence = sequence + 1;
+    writeLock.unlockIrqRestore(status);
 }
\ No newline at end of file
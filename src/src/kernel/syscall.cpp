@@ -4,6 +4,7 @@
 #include "asm_utils.h"
 #include "os_modules.h"
 #include "stdio.h"
+#include "lockstat.h"
 
 int system_call_table[MAX_SYSTEM_CALL];
 
@@ -54,4 +55,29 @@ int wait(int *retval) {
 
 int syscall_wait(int *retval) {
     return programManager.wait(retval);
+}
+
+int futex_wait(int *address, int expected, int timeout) {
+    return asm_system_call(5, (int)address, expected, timeout);
+}
+
+int syscall_futex_wait(int *address, int expected, int timeout) {
+    return futexManager.wait(address, expected, timeout);
+}
+
+int futex_wake(int *address, int count) {
+    return asm_system_call(6, (int)address, count);
+}
+
+int syscall_futex_wake(int *address, int count) {
+    return futexManager.wake(address, count);
+}
+
+int lockstat() {
+    return asm_system_call(7);
+}
+
+int syscall_lockstat() {
+    lockstat_print();
+    return 0;
 }
\ No newline at end of file
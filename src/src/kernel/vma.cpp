@@ -0,0 +1,272 @@
+#include "vma.h"
+#include "os_constant.h"
+#include "os_modules.h"
+#include "memory.h"
+
+void VMAOrder::update(VMA *vma)
+{
+    VMA *left = VMATree::left(vma);
+    VMA *right = VMATree::right(vma);
+
+    vma->largestGap = vma->gap;
+    if (left && left->largestGap > vma->largestGap)
+    {
+        vma->largestGap = left->largestGap;
+    }
+    if (right && right->largestGap > vma->largestGap)
+    {
+        vma->largestGap = right->largestGap;
+    }
+}
+
+void AddressSpace::initialize(const int start, const uint32 limit)
+{
+    this->startAddress = start;
+    this->limit = limit;
+    vmas.initialize();
+    pages.initialize();
+}
+
+int AddressSpace::allocate(const int count)
+{
+    if (count <= 0)
+    {
+        return -1;
+    }
+
+    uint32 size = (uint32)count * PAGE_SIZE;
+    uint32 address;
+    VMA *next = vmas.root();
+
+    if (next && next->largestGap >= size)
+    {
+        // 沿largestGap下降，找到地址最低的足够大的空隙，空隙位于next之前
+        while (true)
+        {
+            VMA *left = VMATree::left(next);
+            if (left && left->largestGap >= size)
+            {
+                next = left;
+            }
+            else if (next->gap >= size)
+            {
+                break;
+            }
+            else
+            {
+                next = VMATree::right(next);
+            }
+        }
+        address = next->start - next->gap;
+    }
+    else
+    {
+        // 只剩最后一个区域之后的空间
+        VMA *last = vmas.last();
+        address = last ? last->end() : (uint32)startAddress;
+        if (limit - address < size)
+        {
+            return -1;
+        }
+        next = nullptr;
+    }
+
+    VMA *previous = next ? VMATree::previous(next) : vmas.last();
+    uint32 protection = VMA_READ | VMA_WRITE;
+
+    bool mergePrevious = previous && previous->end() == address &&
+                         previous->protection == protection && previous->backing == VMA_ANONYMOUS;
+    bool mergeNext = next && next->start == address + size &&
+                     next->protection == protection && next->backing == VMA_ANONYMOUS;
+
+    if (mergePrevious && mergeNext)
+    {
+        // 空隙被填满，两个区域合为一个
+        previous->length += size + next->length;
+        erase(next);
+    }
+    else if (mergePrevious)
+    {
+        previous->length += size;
+        if (next)
+        {
+            resetGap(next);
+        }
+    }
+    else if (mergeNext)
+    {
+        next->start = address;
+        next->length += size;
+        resetGap(next);
+    }
+    else
+    {
+        VMA *vma = createVMA(address, size, protection, VMA_ANONYMOUS);
+        if (!vma)
+        {
+            return -1;
+        }
+        insert(vma);
+    }
+
+    return address;
+}
+
+void AddressSpace::release(const int address, const int amount)
+{
+    uint32 start = address;
+    uint32 end = start + (uint32)amount * PAGE_SIZE;
+
+    while (start < end)
+    {
+        VMA *vma = find(start);
+        if (!vma)
+        {
+            break;
+        }
+
+        uint32 cut = vma->end() < end ? vma->end() : end;
+
+        if (start == vma->start && cut == vma->end())
+        {
+            erase(vma);
+        }
+        else if (start == vma->start)
+        {
+            // 释放头部
+            vma->start = cut;
+            vma->length -= cut - start;
+            resetGap(vma);
+        }
+        else if (cut == vma->end())
+        {
+            // 释放尾部
+            vma->length = start - vma->start;
+            VMA *next = VMATree::next(vma);
+            if (next)
+            {
+                resetGap(next);
+            }
+        }
+        else
+        {
+            // 释放中间部分，区域一分为二
+            VMA *tail = createVMA(cut, vma->end() - cut, vma->protection, vma->backing);
+            if (!tail)
+            {
+                break;
+            }
+            vma->length = start - vma->start;
+            insert(tail);
+        }
+
+        start = cut;
+    }
+}
+
+VMA *AddressSpace::find(const uint32 address)
+{
+    VMA *vma = vmas.root();
+
+    while (vma)
+    {
+        if (address < vma->start)
+        {
+            vma = VMATree::left(vma);
+        }
+        else if (address >= vma->end())
+        {
+            vma = VMATree::right(vma);
+        }
+        else
+        {
+            return vma;
+        }
+    }
+
+    return nullptr;
+}
+
+bool AddressSpace::copy(AddressSpace *from)
+{
+    destroy();
+
+    startAddress = from->startAddress;
+    limit = from->limit;
+
+    for (VMA *vma = from->vmas.first(); vma; vma = VMATree::next(vma))
+    {
+        VMA *copied = createVMA(vma->start, vma->length, vma->protection, vma->backing);
+        if (!copied)
+        {
+            return false;
+        }
+        copied->gap = vma->gap;
+        // 按地址顺序插入，空隙与原区域相同，不需要重新计算
+        vmas.insert(copied);
+    }
+
+    return true;
+}
+
+void AddressSpace::destroy()
+{
+    VMA *vma;
+
+    while ((vma = vmas.root()))
+    {
+        vmas.erase(vma);
+        memoryManager.vmaCache.release(vma);
+    }
+
+    pages.destroy(release_page_meta);
+}
+
+VMA *AddressSpace::createVMA(uint32 start, uint32 length, uint32 protection, int backing)
+{
+    VMA *vma = (VMA *)memoryManager.vmaCache.allocate();
+    if (!vma)
+    {
+        return nullptr;
+    }
+
+    vma->start = start;
+    vma->length = length;
+    vma->protection = protection;
+    vma->backing = backing;
+    vma->gap = 0;
+    vma->largestGap = 0;
+    return vma;
+}
+
+void AddressSpace::insert(VMA *vma)
+{
+    vmas.insert(vma);
+    resetGap(vma);
+
+    VMA *next = VMATree::next(vma);
+    if (next)
+    {
+        resetGap(next);
+    }
+}
+
+void AddressSpace::erase(VMA *vma)
+{
+    VMA *next = VMATree::next(vma);
+
+    vmas.erase(vma);
+    memoryManager.vmaCache.release(vma);
+
+    if (next)
+    {
+        resetGap(next);
+    }
+}
+
+void AddressSpace::resetGap(VMA *vma)
+{
+    VMA *previous = VMATree::previous(vma);
+    vma->gap = vma->start - (previous ? previous->end() : (uint32)startAddress);
+    vmas.refresh(vma);
+}
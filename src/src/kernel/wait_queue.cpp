@@ -0,0 +1,173 @@
+#include "wait_queue.h"
+#include "sync.h"
+#include "os_modules.h"
+#include "program.h"
+
+static PCB *entry(ListItem *item)
+{
+    return list_entry<PCB, &PCB::tagInGeneralList>(item);
+}
+
+// 判断线程a的优先级是否高于线程b，实时线程高于普通线程
+bool higher_priority(PCB *a, PCB *b)
+{
+    bool aRealtime = a->policy != SchedulePolicy::SCHED_NORMAL;
+    bool bRealtime = b->policy != SchedulePolicy::SCHED_NORMAL;
+
+    if (aRealtime != bRealtime)
+    {
+        return aRealtime;
+    }
+
+    if (aRealtime)
+    {
+        return a->rtPriority > b->rtPriority;
+    }
+
+    return a->priority > b->priority;
+}
+
+WaitQueue::WaitQueue()
+{
+    initialize();
+}
+
+void WaitQueue::initialize()
+{
+    waiting.initialize();
+    nonExclusive = 0;
+}
+
+int WaitQueue::sleep(SpinLock *lock, uint64 deadline, bool exclusive)
+{
+    enqueue(deadline, exclusive);
+    return block(lock);
+}
+
+void WaitQueue::enqueue(uint64 deadline, bool exclusive)
+{
+    PCB *cur = programManager.running;
+
+    // 按优先级插入，排在同优先级的等待者之后，不高于队尾时直接加入队尾
+    PCB *last = entry(waiting.back());
+    if (!last || !higher_priority(cur, last))
+    {
+        waiting.push_back(&(cur->tagInGeneralList));
+    }
+    else
+    {
+        PCB *position = front();
+        while (!higher_priority(cur, position))
+        {
+            position = next(position);
+        }
+        waiting.insert(&(position->tagInGeneralList), &(cur->tagInGeneralList));
+    }
+
+    cur->waitQueue = this;
+    cur->waitStatus = WaitStatus::WAIT_OK;
+    cur->exclusive = exclusive;
+    cur->status = ProgramStatus::BLOCKED;
+    if (!exclusive)
+    {
+        ++nonExclusive;
+    }
+
+    // 超时堆已满时按立即超时处理，block只让出一次CPU
+    if (deadline && !programManager.addTimeout(cur, deadline))
+    {
+        remove(cur, WaitStatus::WAIT_TIMEOUT);
+        cur->status = ProgramStatus::RUNNING;
+    }
+}
+
+int WaitQueue::block(SpinLock *lock)
+{
+    PCB *cur = programManager.running;
+
+    // 保持关中断直到调度，阻塞和调度之间不会丢失唤醒
+    if (lock)
+    {
+        lock->unlock();
+    }
+    programManager.schedule();
+    interruptManager.disableInterrupt();
+
+    return cur->waitStatus;
+}
+
+int WaitQueue::wakeUp(int count)
+{
+    ProgramList wakeList;
+    wakeList.initialize();
+
+    PCB *program = front();
+    PCB *following;
+    int woken = 0;
+
+    // 剩下的都是互斥等待者且已唤醒够count个时停止，wakeUp(1)不必遍历整个队列
+    while (program && (count > 0 || nonExclusive > 0))
+    {
+        following = next(program);
+        if (!program->exclusive || count > 0)
+        {
+            if (program->exclusive)
+            {
+                --count;
+            }
+            remove(program, WaitStatus::WAIT_OK);
+            wakeList.push_back(program);
+            ++woken;
+        }
+        program = following;
+    }
+
+    programManager.MESA_WakeUpAll(&wakeList);
+    return woken;
+}
+
+int WaitQueue::wakeUpAll()
+{
+    return wakeUp(0x7fffffff);
+}
+
+PCB *WaitQueue::front()
+{
+    return entry(waiting.front());
+}
+
+PCB *WaitQueue::next(PCB *program)
+{
+    return entry(waiting.next(&(program->tagInGeneralList)));
+}
+
+void WaitQueue::remove(PCB *program, int status)
+{
+    waiting.erase(&(program->tagInGeneralList));
+    if (!program->exclusive)
+    {
+        --nonExclusive;
+    }
+    program->waitQueue = nullptr;
+    program->waitStatus = status;
+
+    if (programManager.timeoutHeap.contains(program))
+    {
+        programManager.cancelTimeout(program);
+    }
+}
+
+bool WaitQueue::empty()
+{
+    return waiting.empty();
+}
+
+uint64 WaitQueue::toDeadline(int timeout)
+{
+    if (timeout < 0)
+    {
+        return 0;
+    }
+
+    return systemClock.getJiffies() + systemClock.usToTicks(timeout);
+}
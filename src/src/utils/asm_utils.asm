@@ -8,11 +8,17 @@ global asm_out_port
 global asm_in_port
 global asm_time_interrupt_handler
 global asm_pageFault_handler
+global asm_disk_interrupt_handler
 global asm_enable_interrupt
 global asm_disable_interrupt
 global asm_interrupt_status
 global asm_switch_thread
 global asm_atomic_exchange
+global asm_atomic_fetch_add
+global asm_atomic_cmpxchg
+global asm_cpu_pause
+global asm_memory_barrier
+global asm_idle
 global asm_init_page_reg
 global asm_system_call
 global asm_system_call_handler
@@ -22,9 +28,23 @@ global asm_start_process
 global asm_update_cr3
 global asm_inw_port
 global asm_outw_port
+global asm_inl_port
+global asm_outl_port
 global asm_update_tlb
+global asm_read_tsc
+global asm_udiv64
+global asm_cpuid
+global asm_enable_global_pages
+global asm_invlpg
+global asm_enable_sse
+global asm_memcpy
+global asm_memcpy_backward
+global asm_memset
+global asm_copy_page_sse2
+global asm_clear_page_sse2
 extern c_time_interrupt_handler
 extern c_pageFault_handler
+extern c_disk_interrupt_handler
 extern system_call_table
 ASM_UNHANDLED_INTERRUPT_INFO db 'Unhandled interrupt happened, halt...'
                              db 0
@@ -33,6 +53,184 @@ ASM_IDTR dw 0
 ASM_GDTR dw 0
          dd 0
 ASM_TEMP dd 0
+; uint64 asm_read_tsc();
+asm_read_tsc:
+    rdtsc ; edx:eax = 时间戳计数器
+    ret
+
+; void asm_cpuid(uint32 leaf, uint32 *result);
+asm_cpuid:
+    push ebp
+    mov ebp, esp
+    pushad
+
+    mov eax, [ebp + 4 * 2] ; leaf
+    xor ecx, ecx
+    cpuid
+    mov edi, [ebp + 4 * 3] ; result[0..3] = eax, ebx, ecx, edx
+    mov [edi], eax
+    mov [edi + 4], ebx
+    mov [edi + 4 * 2], ecx
+    mov [edi + 4 * 3], edx
+
+    popad
+    pop ebp
+    ret
+
+; void asm_enable_global_pages();
+asm_enable_global_pages:
+    push eax
+    mov eax, cr4
+    or eax, 0x80 ; 置PGE=1，G=1的页表项在重新加载CR3时不被刷新
+    mov cr4, eax
+    pop eax
+    ret
+
+; void asm_invlpg(int address);
+asm_invlpg:
+    push eax
+    mov eax, [esp + 4 * 2]
+    invlpg [eax] ; 只刷新一个页的TLB表项，包括全局页
+    pop eax
+    ret
+
+; void asm_enable_sse();
+asm_enable_sse:
+    push eax
+    mov eax, cr0
+    and eax, ~0x4 ; EM=0，不模拟浮点
+    or eax, 0x2   ; MP=1
+    mov cr0, eax
+    mov eax, cr4
+    or eax, 0x600 ; OSFXSR=1，OSXMMEXCPT=1，允许使用SSE指令
+    mov cr4, eax
+    pop eax
+    ret
+
+; void asm_memcpy(void *dst, const void *src, uint32 length);
+asm_memcpy:
+    push esi
+    push edi
+    mov edi, [esp + 4 * 3]
+    mov esi, [esp + 4 * 4]
+    mov edx, [esp + 4 * 5]
+    mov ecx, edx
+    shr ecx, 2
+    rep movsd      ; 先按双字复制
+    mov ecx, edx
+    and ecx, 3
+    rep movsb      ; 再复制剩余的字节
+    pop edi
+    pop esi
+    ret
+
+; void asm_memcpy_backward(void *dst, const void *src, uint32 length);
+asm_memcpy_backward:
+    push esi
+    push edi
+    pushfd
+    cli            ; 中断入口不执行cld，DF=1期间不能响应中断
+    mov edi, [esp + 4 * 4]
+    mov esi, [esp + 4 * 5]
+    mov edx, [esp + 4 * 6]
+    std            ; 从高地址向低地址复制，dst与src重叠且dst在后时不会覆盖未复制的数据
+    lea esi, [esi + edx - 1]
+    lea edi, [edi + edx - 1]
+    mov ecx, edx
+    and ecx, 3
+    rep movsb      ; 先复制末尾不足一个双字的字节
+    sub esi, 3
+    sub edi, 3
+    mov ecx, edx
+    shr ecx, 2
+    rep movsd
+    cld
+    popfd
+    pop edi
+    pop esi
+    ret
+
+; void asm_memset(void *dst, uint32 value, uint32 length);
+asm_memset:
+    push edi
+    mov edi, [esp + 4 * 2]
+    movzx eax, byte[esp + 4 * 3]
+    mov edx, [esp + 4 * 4]
+    imul eax, eax, 0x01010101 ; 将字节扩展到双字的4个字节
+    mov ecx, edx
+    shr ecx, 2
+    rep stosd
+    mov ecx, edx
+    and ecx, 3
+    rep stosb
+    pop edi
+    ret
+
+; void asm_copy_page_sse2(void *dst, const void *src);
+; dst和src按16字节对齐，使用非临时存储绕过cache，不污染cache
+; 线程切换时不保存xmm寄存器，复制期间关中断
+asm_copy_page_sse2:
+    push esi
+    push edi
+    pushfd
+    cli
+    mov edi, [esp + 4 * 4]
+    mov esi, [esp + 4 * 5]
+    mov ecx, 4096 / 64
+.copy:
+    prefetchnta [esi + 64 * 4]
+    movdqa xmm0, [esi]
+    movdqa xmm1, [esi + 16]
+    movdqa xmm2, [esi + 16 * 2]
+    movdqa xmm3, [esi + 16 * 3]
+    movntdq [edi], xmm0
+    movntdq [edi + 16], xmm1
+    movntdq [edi + 16 * 2], xmm2
+    movntdq [edi + 16 * 3], xmm3
+    add esi, 64
+    add edi, 64
+    dec ecx
+    jnz .copy
+    sfence         ; 非临时存储对之后的读写可见
+    popfd
+    pop edi
+    pop esi
+    ret
+
+; void asm_clear_page_sse2(void *dst);
+asm_clear_page_sse2:
+    push edi
+    pushfd
+    cli
+    mov edi, [esp + 4 * 3]
+    mov ecx, 4096 / 64
+    pxor xmm0, xmm0
+.clear:
+    movntdq [edi], xmm0
+    movntdq [edi + 16], xmm0
+    movntdq [edi + 16 * 2], xmm0
+    movntdq [edi + 16 * 3], xmm0
+    add edi, 64
+    dec ecx
+    jnz .clear
+    sfence
+    popfd
+    pop edi
+    ret
+
+; uint64 asm_udiv64(uint64 dividend, uint32 divisor);
+asm_udiv64:
+    push ebx
+    mov ecx, dword[esp + 4 * 4] ; divisor
+    xor edx, edx
+    mov eax, dword[esp + 4 * 3] ; 被除数高32位
+    div ecx
+    mov ebx, eax                ; 商的高32位
+    mov eax, dword[esp + 4 * 2] ; 被除数低32位，edx为上一步的余数
+    div ecx
+    mov edx, ebx
+    pop ebx
+    ret
 ;  void asm_update_tlb();
 asm_update_tlb:
     cli
@@ -72,6 +270,38 @@ asm_outw_port:
     mov eax, dword[ebp + 4 * 3]
     out dx, ax
 
+    pop edx
+    pop ebp
+    ret
+; void asm_inl_port(uint16 port, uint32 *value);
+asm_inl_port:
+    push ebp
+    mov ebp, esp
+
+    push edx
+    push ebx
+
+    mov edx, dword[ebp + 4 * 2]
+    mov ebx, dword[ebp + 4 * 3]
+    in eax, dx
+    mov dword[ebx], eax
+
+    pop ebx
+    pop edx
+    pop ebp
+    ret
+
+; void asm_outl_port(uint16 port, uint32 value);
+asm_outl_port:
+    push ebp
+    mov ebp, esp
+
+    push edx
+
+    mov edx, dword[ebp + 4 * 2]
+    mov eax, dword[ebp + 4 * 3]
+    out dx, eax
+
     pop edx
     pop ebp
     ret
@@ -235,6 +465,39 @@ asm_atomic_exchange:
     pop ebp
     ret
 
+; uint32 asm_atomic_fetch_add(uint32 *memory, uint32 value);
+asm_atomic_fetch_add:
+    mov ecx, [esp + 4 * 1] ; memory
+    mov eax, [esp + 4 * 2] ; value
+    lock xadd [ecx], eax   ; eax = 原值，[ecx] += value
+    ret
+
+; uint32 asm_atomic_cmpxchg(uint32 *memory, uint32 expected, uint32 desired);
+asm_atomic_cmpxchg:
+    push ebx
+    mov ecx, [esp + 4 * 2] ; memory
+    mov eax, [esp + 4 * 3] ; expected
+    mov ebx, [esp + 4 * 4] ; desired
+    lock cmpxchg [ecx], ebx ; [ecx] == eax 时写入ebx，eax = 原值
+    pop ebx
+    ret
+
+; void asm_cpu_pause();
+asm_cpu_pause:
+    pause ; 提示CPU处于自旋等待
+    ret
+
+; void asm_memory_barrier();
+asm_memory_barrier:
+    lock or dword[esp], 0 ; 带lock前缀的指令是完整的内存屏障，调用本身也阻止编译器重排
+    ret
+
+; void asm_idle();
+asm_idle:
+    sti ; sti之后的一条指令执行完才响应中断，检查就绪队列和hlt之间不会丢失唤醒
+    hlt
+    ret
+
 ; void asm_switch_thread(PCB *cur, PCB *next);
 asm_switch_thread:
     push ebp
@@ -293,9 +556,31 @@ asm_time_interrupt_handler:
     popad
     iret
 
+asm_disk_interrupt_handler:
+    pushad
+    push ds
+    push es
+    push fs
+    push gs
+
+    ; IRQ14来自从片，主片和从片都要发送EOI
+    mov al, 0x20
+    out 0xa0, al
+    out 0x20, al
+
+    call c_disk_interrupt_handler
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popad
+    iret
+
 asm_pageFault_handler:
 
     cli ;incase time interupt stop us
+    cld ; 缺页可能发生在asm_memcpy_backward的反向复制中，处理函数需要DF=0，iret时恢复
 
     
     push ebp
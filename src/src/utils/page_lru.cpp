@@ -0,0 +1,115 @@
+#include "page_lru.h"
+#include "os_constant.h"
+#include "stdio.h"
+#include "asm_utils.h"
+
+void PageLRU::initializeLRU(const int startAddress)
+{
+    this->startAddress = startAddress;
+    // 清空时间戳
+    for(int i = 0; i < MAX_PAGES; ++i)
+    {
+        lrucnt[i] = 0;
+        lruindex[i] = -1;
+    }
+    // 初始化时钟
+    clock = 0;
+}
+
+void PageLRU::track(const int start, const int count)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        int j = 0;
+        while (j < MAX_PAGES && lruindex[j] != -1)
+        {
+            ++j;
+        }
+        if(j == MAX_PAGES)
+        {
+            printf("Exeed the memory queue. halt ...\n");
+            asm_halt();
+            return;
+        }
+        lruindex[j] = i + start;
+        lrucnt[j] = clock;
+    }
+}
+
+void PageLRU::untrack(const int start, const int count)
+{
+    // TODO
+    for(int i = 0; i < count; ++i)
+    {
+        int j = 0;
+        while (j < MAX_PAGES && lruindex[j] != i + start)
+        {
+            ++j;
+        }
+        if (j == MAX_PAGES)
+        {
+            continue;
+        }
+        lruindex[j] = -1;
+        lrucnt[j] = 0;
+    }
+}
+
+int PageLRU::find(const int index)
+{
+    for (int i = 0; i < MAX_PAGES; ++i)
+    {
+        if (lruindex[i] == index)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PageLRU::LRU()
+{
+    ++clock;
+    for (int i = 0; i < MAX_PAGES; ++i)
+    {
+        if(lruindex[i] == -1)
+        // 如果没有被分配，则跳过
+            continue;
+        int vaddr = startAddress + lruindex[i] * PAGE_SIZE;
+        unsigned int* pte = (unsigned int*)(0xffc00000 + ((vaddr & 0xffc00000) >> 10) + (((vaddr & 0x003ff000) >> 12) * 4));
+        if((*pte) & (1<<5))
+        {
+            // printf_error("Updating index %d\n", i);
+            lrucnt[i] = clock;
+            // 访问位置零，脏位留给换出时判断交换区中的副本是否有效
+            (*pte) = (*pte) & (~(1 << 5));
+        }
+    }
+}
+
+int PageLRU::Out()
+{
+    int Min = clock, index = -1;
+    printf("lruCNT Array: ");
+    for (int i = 0; i < MAX_PAGES; ++i)
+    {
+        if(lruindex[i] == -1)
+        // 如果没有被分配，则跳过
+            continue;
+        printf("[%d, %d] ",lruindex[i], lrucnt[i]);
+        if(lrucnt[i] < Min)
+        {
+            Min = lrucnt[i];
+            index = lruindex[i];
+        }
+    }
+    // 所有记录的页在本周期内都被访问过，不能把未记录的页交给换出
+    if (index == -1)
+    {
+        printf("\n[Swap out] no victim\n");
+        return -1;
+    }
+    printf("\n[Swap out] index  = %d, vaddr = 0x%x\n",index, startAddress + index * PAGE_SIZE);
+    return startAddress + index * PAGE_SIZE;
+
+}
@@ -1,4 +1,9 @@
 #include "os_type.h"
+#include "os_constant.h"
+#include "asm_utils.h"
+
+// 支持SSE2时，copy_page和clear_page使用非临时存储
+static bool useSSE2 = false;
 
 template <typename T>
 void swap(T &x, T &y)
@@ -47,9 +52,9 @@ void itos(char *numStr, uint32 num, uint32 mod)
 
 void memset(void *memory, char value, int length)
 {
-    for (int i = 0; i < length; ++i)
+    if (length > 0)
     {
-        ((char *)memory)[i] = value;
+        asm_memset(memory, (uint8)value, length);
     }
 }
 
@@ -60,9 +65,56 @@ int ceil(const int dividend, const int divisor)
 
 void memcpy(void *src, void *dst, uint32 length)
 {
-    for (uint32 i = 0; i < length; ++i)
+    asm_memcpy(dst, src, length);
+}
+
+void memmove(void *src, void *dst, uint32 length)
+{
+    // dst在src之后且两者重叠时从后向前复制
+    if ((uint32)dst > (uint32)src && (uint32)dst - (uint32)src < length)
+    {
+        asm_memcpy_backward(dst, src, length);
+    }
+    else
+    {
+        asm_memcpy(dst, src, length);
+    }
+}
+
+void copy_page(void *src, void *dst)
+{
+    if (useSSE2)
+    {
+        asm_copy_page_sse2(dst, src);
+    }
+    else
+    {
+        asm_memcpy(dst, src, PAGE_SIZE);
+    }
+}
+
+void clear_page(void *page)
+{
+    if (useSSE2)
+    {
+        asm_clear_page_sse2(page);
+    }
+    else
+    {
+        asm_memset(page, 0, PAGE_SIZE);
+    }
+}
+
+void select_page_routines()
+{
+    uint32 result[4];
+
+    // CPUID.01H:EDX[26]表示支持SSE2
+    asm_cpuid(1, result);
+    if (result[3] & (1 << 26))
     {
-        ((char *)dst)[i] = ((char *)src)[i];
+        asm_enable_sse();
+        useSSE2 = true;
     }
 }
 
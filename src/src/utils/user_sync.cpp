@@ -0,0 +1,93 @@
+#include "user_sync.h"
+#include "asm_utils.h"
+#include "syscall.h"
+
+// 原子地将*address设置为value，返回原值
+static int exchange(volatile int *address, int value)
+{
+    uint32 temp = value;
+    asm_atomic_exchange(&temp, (uint32 *)address);
+    return temp;
+}
+
+UserMutex::UserMutex()
+{
+    initialize();
+}
+
+void UserMutex::initialize()
+{
+    state = 0;
+}
+
+void UserMutex::lock()
+{
+    // 快速路径：没有竞争时只需一次cmpxchg
+    int c = asm_atomic_cmpxchg((volatile uint32 *)&state, 0, 1);
+    if (c == 0)
+    {
+        return;
+    }
+
+    // 标记存在等待者后阻塞，被唤醒后重新竞争
+    if (c != 2)
+    {
+        c = exchange(&state, 2);
+    }
+    while (c != 0)
+    {
+        futex_wait((int *)&state, 2);
+        c = exchange(&state, 2);
+    }
+}
+
+void UserMutex::unlock()
+{
+    // 原值为1说明没有等待者，不需要陷入内核
+    if (asm_atomic_fetch_add((volatile uint32 *)&state, (uint32)-1) != 1)
+    {
+        state = 0;
+        futex_wake((int *)&state, 1);
+    }
+}
+
+UserConditionVariable::UserConditionVariable()
+{
+    initialize();
+}
+
+void UserConditionVariable::initialize()
+{
+    sequence = 0;
+    waiters = 0;
+}
+
+void UserConditionVariable::wait(UserMutex &mutex)
+{
+    // 释放mutex之前记下序号，之后的signal会改变序号，futex_wait不会阻塞
+    int seq = sequence;
+    asm_atomic_fetch_add((volatile uint32 *)&waiters, 1);
+
+    mutex.unlock();
+    futex_wait((int *)&sequence, seq);
+    asm_atomic_fetch_add((volatile uint32 *)&waiters, (uint32)-1);
+    mutex.lock();
+}
+
+void UserConditionVariable::signal()
+{
+    asm_atomic_fetch_add((volatile uint32 *)&sequence, 1);
+    if (waiters)
+    {
+        futex_wake((int *)&sequence, 1);
+    }
+}
+
+void UserConditionVariable::broadcast()
+{
+    asm_atomic_fetch_add((volatile uint32 *)&sequence, 1);
+    if (waiters)
+    {
+        futex_wake((int *)&sequence, 0x7fffffff);
+    }
+}